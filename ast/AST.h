@@ -30,12 +30,13 @@ public:
         STRING,
         BOOL,
         LIST,
+        MATRIX,  // Dense 2-D int or float matrix, row-major
         VOID,
         MATHOBJECT
     };
 
     Kind kind;
-    TypePtr elementType;  // For List types
+    TypePtr elementType;  // For List and Matrix types
 
     explicit Type(Kind k, TypePtr elemType = nullptr)
         : kind(k), elementType(std::move(elemType)) {}
@@ -63,6 +64,9 @@ public:
 class Identifier : public Expression {
 public:
     std::string name;
+    // Set by the optimizer on the last use of a list or string variable,
+    // which the C++ backend moves from instead of copying
+    bool lastUse = false;
 
     Identifier(std::string n)
         : name(std::move(n)) {}
@@ -73,12 +77,16 @@ public:
     enum class Operator {
         ADD, SUB, MUL, DIV, MOD,
         EQ, NE, LT, GT, LE, GE,
-        AND, OR
+        AND, OR,
+        // Only produced by the optimizer, for operands known to be non-negative
+        SHR, BITAND
     };
 
     Operator op;
     ExprPtr left;
     ExprPtr right;
+    // Set by the optimizer when the divisor of DIV/MOD can never be zero
+    bool nonZeroDivisor = false;
 
     BinaryOp(Operator o, ExprPtr l, ExprPtr r)
         : op(o), left(std::move(l)), right(std::move(r)) {}
@@ -145,6 +153,18 @@ public:
     TypePtr type;
     std::string name;
     ExprPtr initializer;
+    // Set by the optimizer when neither the variable nor the value it is
+    // initialized from changes while it is in scope; C++ binds a const reference
+    bool bindReference = false;
+    // Set by the optimizer for a local list used as a queue, through prepend
+    // or remove(0): C++ stores it in a std::deque, and Python in a
+    // collections.deque unless the list is also indexed away from its ends.
+    // A short list C++ keeps inline instead, in a std::array of `capacity`
+    // elements if it is never resized, or else an hl::small_vector that
+    // never holds more than `capacity`
+    enum class Container { List, Deque, DequeCppOnly, Array, SmallVector };
+    Container container = Container::List;
+    int capacity = 0;
 
     VarDecl(bool ic, TypePtr t, std::string n, ExprPtr init)
         : isConst(ic), type(std::move(t)), name(std::move(n)),
@@ -155,6 +175,8 @@ class Assignment : public Statement, public Expression {
 public:
     ExprPtr target;
     ExprPtr value;
+    // Set by the optimizer for `s = s + ...` on strings; C++ appends in place
+    bool appendInPlace = false;
 
     Assignment(ExprPtr t, ExprPtr v)
         : target(std::move(t)), value(std::move(v)) {}
@@ -178,6 +200,8 @@ class While : public Statement {
 public:
     ExprPtr condition;
     std::vector<StmtPtr> body;
+    // Set by the optimizer, as for For
+    std::vector<std::string> builtStrings;
 
     While(ExprPtr cond, std::vector<StmtPtr> b)
         : condition(std::move(cond)), body(std::move(b)) {}
@@ -190,6 +214,19 @@ public:
     ExprPtr end;
     ExprPtr step;
     std::vector<StmtPtr> body;
+    // `parallel for`: iterations may run on several threads. Each reduction
+    // variable is combined across threads with its operator: ADD and MUL,
+    // or GT and LT for the maximum and minimum (found by the optimizer)
+    bool parallel = false;
+    std::vector<std::pair<BinaryOp::Operator, std::string>> reductions;
+    // Set by the optimizer: loops with fewer iterations run on one thread
+    long long minParallelTrips = 0;
+    // Set by the optimizer: local strings the loop only appends to, which
+    // Python builds from a list of parts joined after the loop
+    std::vector<std::string> builtStrings;
+    // Set by the optimizer: local lists the loop appends to once in every
+    // iteration, which C++ reserves room for before the loop
+    std::vector<std::string> reservedLists;
 
     For(std::string it, ExprPtr s, ExprPtr e, ExprPtr st, std::vector<StmtPtr> b)
         : iterator(std::move(it)), start(std::move(s)), end(std::move(e)),
@@ -202,6 +239,10 @@ public:
     std::vector<std::pair<TypePtr, std::string>> parameters;
     std::vector<StmtPtr> body;
     TypePtr returnType;
+    // Set by the optimizer for pure functions whose results the backends cache
+    bool memoize = false;
+    // Set by the optimizer, per parameter: never modified, so C++ takes it by const reference
+    std::vector<bool> constRefParams;
 
     Function(std::string n, std::vector<std::pair<TypePtr, std::string>> params,
              std::vector<StmtPtr> b, TypePtr rt = nullptr)
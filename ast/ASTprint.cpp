@@ -17,6 +17,7 @@ namespace ASTPrinter {
             case Type::Kind::STRING: return "string";
             case Type::Kind::BOOL: return "bool";
             case Type::Kind::LIST: return "list";
+            case Type::Kind::MATRIX: return "matrix";
             case Type::Kind::VOID: return "void";
             default: return "unknown";
         }
@@ -28,7 +29,7 @@ namespace ASTPrinter {
             return "null";
         }
         std::string result = typeKindToString(type->kind);
-        if (type->kind == Type::Kind::LIST && type->elementType) {
+        if ((type->kind == Type::Kind::LIST || type->kind == Type::Kind::MATRIX) && type->elementType) {
             result += "<" + typeToString(type->elementType) + ">";
         }
         return result;
@@ -49,6 +50,8 @@ namespace ASTPrinter {
             case BinaryOp::Operator::GE:  return ">=";
             case BinaryOp::Operator::AND: return "and";
             case BinaryOp::Operator::OR:  return "or";
+            case BinaryOp::Operator::SHR: return ">>";
+            case BinaryOp::Operator::BITAND: return "&";
             default: return "?";
         }
     }
@@ -116,7 +119,15 @@ namespace ASTPrinter {
             printAST(inputStmt->prompt, indent + 1);
         } else if (auto forStmt = std::dynamic_pointer_cast<For>(node)) {
             printIndent(indent);
-            std::cout << "For Loop with iterator: " << forStmt->iterator << std::endl;
+            std::cout << (forStmt->parallel ? "Parallel For Loop with iterator: " : "For Loop with iterator: ")
+                      << forStmt->iterator << std::endl;
+            for (const auto& [op, name] : forStmt->reductions) {
+                printIndent(indent + 1);
+                const char* kind = op == BinaryOp::Operator::MUL ? "*"
+                                   : op == BinaryOp::Operator::GT ? "max"
+                                   : op == BinaryOp::Operator::LT ? "min" : "+";
+                std::cout << "Reduction: " << kind << " " << name << std::endl;
+            }
             printIndent(indent + 1);
             std::cout << "Start:" << std::endl;
             printAST(forStmt->start, indent + 2);
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Measures how long the driver takes to build the C++ for every example,
+# compiling the runtime from source with each program (--no-pch) and against
+# the precompiled header and runtime library.
+#
+# Usage: benchmarks/build_time.sh [path/to/HorizonLang] [extra driver options]
+# Run from the repository root; the compiler defaults to build/HorizonLang.
+
+set -euo pipefail
+
+compiler=$(realpath "${1:-build/HorizonLang}")
+shift || true
+examples=$(realpath examples)
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+export HL_CACHE_DIR="$work/cache"
+
+# Prints the "Built in N ms" figure of one build
+build_ms() {
+    "$compiler" --target=cpp --no-run --no-cache "$@" | sed -n 's/^Built in \([0-9]*\) ms$/\1/p'
+}
+
+# The precompiled runtime is built once per compiler and flags; leave that
+# out of the per-program numbers
+"$compiler" --target=cpp --no-run --no-cache "$@" "$examples/Hello.hl" | grep '^Prepared' || true
+
+printf '%-24s %12s %12s\n' "example" "--no-pch ms" "pch ms"
+total_source=0
+total_pch=0
+for file in "$examples"/*.hl; do
+    source_ms=$(build_ms --no-pch "$@" "$file")
+    pch_ms=$(build_ms "$@" "$file")
+    printf '%-24s %12s %12s\n' "$(basename "$file" .hl)" "$source_ms" "$pch_ms"
+    total_source=$((total_source + source_ms))
+    total_pch=$((total_pch + pch_ms))
+done
+printf '%-24s %12s %12s\n' "total" "$total_source" "$total_pch"
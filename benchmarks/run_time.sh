@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Times the C++ programs generated for every benchmarks/*.hl program, and
+# optionally compares two builds of the compiler (e.g. before and after a
+# codegen change).
+#
+# Usage: benchmarks/run_time.sh [HorizonLang] [baseline HorizonLang]
+# Run from the repository root; the compiler defaults to build/HorizonLang.
+# Extra driver options can be passed in HL_OPTIONS, e.g. --profile=release.
+
+set -euo pipefail
+
+compilers=("$(realpath "${1:-build/HorizonLang}")")
+if [ $# -ge 2 ]; then
+    compilers+=("$(realpath "$2")")
+fi
+programs=$(realpath benchmarks)
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+
+# Prints the wall-clock run time of one program in milliseconds, or - if
+# this compiler rejects it (e.g. a baseline without a newer builtin)
+run_ms() {
+    local compiler=$1 file=$2
+    # shellcheck disable=SC2086
+    if ! "$compiler" --target=cpp --no-run ${HL_OPTIONS:-} "$file" > /dev/null 2>&1; then
+        echo "-"
+        return
+    fi
+    local start end
+    start=$(date +%s%N)
+    ./output_executable < /dev/null > /dev/null
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000000))
+}
+
+header=$(printf '%-24s %12s' "program" "ms")
+if [ ${#compilers[@]} -eq 2 ]; then
+    header=$(printf '%-24s %12s %12s' "program" "ms" "baseline ms")
+fi
+echo "$header"
+for file in "$programs"/*.hl; do
+    line=$(printf '%-24s' "$(basename "$file" .hl)")
+    for compiler in "${compilers[@]}"; do
+        line+=$(printf ' %12s' "$(run_ms "$compiler" "$file")")
+    done
+    echo "$line"
+done
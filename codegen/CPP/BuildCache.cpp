@@ -0,0 +1,124 @@
+#include "BuildCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+BuildCache::BuildCache(std::string directory, std::uintmax_t sizeLimit)
+    : directory(std::move(directory)), sizeLimit(sizeLimit) {}
+
+std::string BuildCache::defaultDirectory() {
+    if (const char* dir = std::getenv("HL_CACHE_DIR"); dir && *dir) {
+        return dir;
+    }
+    if (const char* dir = std::getenv("XDG_CACHE_HOME"); dir && *dir) {
+        return std::string(dir) + "/horizonlang";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return std::string(home) + "/.cache/horizonlang";
+    }
+    return ".horizonlang-cache";
+}
+
+std::string BuildCache::hashKey(const std::string& data) {
+    // Two FNV-1a passes with different offsets, for a 128-bit name
+    std::uint64_t first = 14695981039346656037ULL;
+    std::uint64_t second = 0x6c62272e07bb0142ULL;
+    for (unsigned char c : data) {
+        first = (first ^ c) * 1099511628211ULL;
+        second = (second ^ c) * 0x100000001b3ULL;
+        second ^= second >> 29;
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    std::string key;
+    for (std::uint64_t part : {first, second}) {
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            key += digits[(part >> shift) & 0xf];
+        }
+    }
+    return key;
+}
+
+bool BuildCache::fetch(const std::string& key, const std::string& path) {
+    std::error_code error;
+    fs::path entry = fs::path(directory) / key;
+    if (!fs::is_regular_file(entry, error)) {
+        return false;
+    }
+    if (!fs::copy_file(entry, path, fs::copy_options::overwrite_existing, error)) {
+        return false;
+    }
+    // The modification time orders entries for eviction
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+    return true;
+}
+
+void BuildCache::store(const std::string& key, const std::string& path) {
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error) {
+        return;
+    }
+
+    // Copied under a temporary name first, so a concurrent fetch never sees
+    // a partly written binary
+    fs::path entry = fs::path(directory) / key;
+    fs::path temporary = entry;
+    temporary += ".tmp" + std::to_string(std::random_device{}());
+    if (!fs::copy_file(path, temporary, fs::copy_options::overwrite_existing, error)) {
+        return;
+    }
+    fs::rename(temporary, entry, error);
+    if (error) {
+        fs::remove(temporary, error);
+    }
+}
+
+// Total size of the files in a directory entry, or of a file entry
+static std::uintmax_t entrySize(const fs::directory_entry& item) {
+    std::error_code error;
+    if (item.is_regular_file(error)) {
+        std::uintmax_t size = item.file_size(error);
+        return error ? 0 : size;
+    }
+    std::uintmax_t total = 0;
+    for (const auto& file : fs::recursive_directory_iterator(item.path(), error)) {
+        if (file.is_regular_file(error)) {
+            std::uintmax_t size = file.file_size(error);
+            total += error ? 0 : size;
+        }
+    }
+    return total;
+}
+
+void BuildCache::evict(const std::vector<std::string>& keep) {
+    std::error_code error;
+    std::vector<std::tuple<fs::file_time_type, fs::path, std::uintmax_t>> entries;
+    std::uintmax_t total = 0;
+    for (const auto& item : fs::directory_iterator(directory, error)) {
+        if (!item.is_regular_file(error) && !item.is_directory(error)) {
+            continue;
+        }
+        std::uintmax_t size = entrySize(item);
+        total += size;
+        if (std::find(keep.begin(), keep.end(), item.path().filename().string()) == keep.end()) {
+            entries.emplace_back(item.last_write_time(error), item.path(), size);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end());
+    for (const auto& [time, entry, size] : entries) {
+        if (total <= sizeLimit) {
+            break;
+        }
+        if (fs::remove_all(entry, error) != static_cast<std::uintmax_t>(-1) && !error) {
+            total -= size;
+        }
+    }
+}
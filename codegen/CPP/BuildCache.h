@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Directory of compiled programs, each stored under a hash of everything that
+// went into building it, next to the precompiled runtimes CppBuilder keeps
+// there in directories of their own. Least recently used entries, files or
+// directories, are removed once the directory grows past its size limit.
+// Every filesystem error is treated as a miss, so a broken cache only costs
+// a rebuild.
+class BuildCache {
+public:
+    BuildCache(std::string directory, std::uintmax_t sizeLimit);
+
+    // $HL_CACHE_DIR, else $XDG_CACHE_HOME/horizonlang, else ~/.cache/horizonlang
+    static std::string defaultDirectory();
+    // Hex digest used as the entry name
+    static std::string hashKey(const std::string& data);
+
+    // Copies the binary stored under key to path; false on a miss
+    bool fetch(const std::string& key, const std::string& path);
+    void store(const std::string& key, const std::string& path);
+    // Removes least recently used entries until the directory fits its
+    // size limit, except those named in keep, which the current build uses
+    void evict(const std::vector<std::string>& keep);
+
+private:
+    std::string directory;
+    std::uintmax_t sizeLimit;
+};
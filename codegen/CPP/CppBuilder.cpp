@@ -0,0 +1,286 @@
+#include "CppBuilder.h"
+#include "BuildCache.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <utility>
+
+CppBuilder::CppBuilder(CppBuildOptions options) : options(std::move(options)) {}
+
+bool CppBuilder::build(const std::string& sourceFile) {
+    // -pthread for the thread pool behind `parallel for`
+    std::string flags = "-std=c++20 -pthread " + profileFlags();
+    if (!options.extraFlags.empty()) {
+        flags += " " + options.extraFlags;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    runtimeSeconds = 0;
+    trained = false;
+    BuildCache cache(cacheDirectory(), options.cacheSizeLimit);
+    // A profile-guided build depends on the profile too, so it is not cached
+    bool pgo = !options.trainingInput.empty();
+    std::string key = options.useCache && !pgo ? cacheKey(sourceFile, flags) : "";
+    cached = !key.empty() && cache.fetch(key, options.outputPath);
+
+    bool built = cached;
+    if (!cached) {
+        // Without a prebuilt runtime the runtime sources are compiled along
+        // with the program
+        std::string prebuilt = options.usePrebuiltRuntime ? prepareRuntime(flags) : "";
+        if (pgo) {
+            built = buildWithProfile(sourceFile, flags, prebuilt);
+        } else {
+            command = compileCommand(sourceFile, flags, prebuilt);
+            built = system(command.c_str()) == 0;
+        }
+        if (built && !key.empty()) {
+            cache.store(key, options.outputPath);
+        }
+        cache.evict({key, std::filesystem::path(prebuilt).filename().string()});
+    }
+    buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return built;
+}
+
+bool CppBuilder::buildWithProfile(const std::string& sourceFile, const std::string& flags,
+                                  const std::string& prebuilt) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    std::string dir = options.profileDir;
+    bool clang = compilerVersion().find("clang") != std::string::npos;
+
+    // The profile is reused for as long as the generated code, flags,
+    // compiler and training input stay the same
+    std::ifstream source(sourceFile);
+    std::ifstream training(options.trainingInput, std::ios::binary);
+    std::stringstream data;
+    data << source.rdbuf() << '\0' << flags << '\0' << compilerVersion() << '\0' << training.rdbuf();
+    std::string stamp = BuildCache::hashKey(data.str());
+    std::ifstream stampFile(dir + "/stamp");
+    std::string previous;
+    std::getline(stampFile, previous);
+
+    if (previous != stamp) {
+        fs::remove_all(dir, error);
+        fs::create_directories(dir, error);
+        if (error) {
+            return false;
+        }
+        // Counters are updated atomically in case the program ever runs threads
+        std::string instrumented = compileCommand(
+            sourceFile, flags, prebuilt, " -fprofile-generate=" + quote(dir) + " -fprofile-update=atomic");
+        if (system(instrumented.c_str()) != 0) {
+            command = instrumented;
+            return false;
+        }
+        // The training run's own output is not interesting, only its profile
+        system((quote(getExecutable()) + " < " + quote(options.trainingInput) + " > /dev/null").c_str());
+        if (clang &&
+            system(("llvm-profdata merge -output=" + quote(dir + "/default.profdata") + " " + quote(dir) +
+                    "/*.profraw").c_str()) != 0) {
+            return false;
+        }
+        std::ofstream(dir + "/stamp") << stamp << "\n";
+        trained = true;
+    }
+
+    // Code the training run never reached is still optimized normally
+    std::string use = clang ? " -fprofile-use=" + quote(dir + "/default.profdata")
+                            : " -fprofile-use=" + quote(dir) + " -fprofile-partial-training -Wno-missing-profile";
+    command = compileCommand(sourceFile, flags, prebuilt, use);
+    return system(command.c_str()) == 0;
+}
+
+std::string CppBuilder::compileCommand(const std::string& sourceFile, const std::string& flags,
+                                       const std::string& prebuilt, const std::string& extra) const {
+    // Not quoted, so the compiler may be given with a launcher, e.g. "ccache g++"
+    std::string result = compilerPath() + " " + flags + extra + " -I " + quote(options.runtimeDir);
+    if (!prebuilt.empty()) {
+        result += " -include " + quote(prebuilt + "/hl_pch.hpp");
+    }
+    return result + " " + quote(sourceFile) + " " +
+           quote(prebuilt.empty() ? options.runtimeDir + "/hl_runtime.cpp" : prebuilt + "/libhl_runtime.a") +
+           " -o " + quote(options.outputPath);
+}
+
+std::string CppBuilder::getExecutable() const {
+    // A bare file name would be looked up on PATH
+    if (options.outputPath.find('/') == std::string::npos) {
+        return "./" + options.outputPath;
+    }
+    return options.outputPath;
+}
+
+std::string CppBuilder::getCommand() const {
+    return command;
+}
+
+double CppBuilder::getBuildSeconds() const {
+    return buildSeconds;
+}
+
+double CppBuilder::getRuntimeSeconds() const {
+    return runtimeSeconds;
+}
+
+bool CppBuilder::wasCached() const {
+    return cached;
+}
+
+bool CppBuilder::wasTrained() const {
+    return trained;
+}
+
+bool CppBuilder::parseProfile(const std::string& name, CppBuildOptions::Profile& profile) {
+    if (name == "fast") {
+        profile = CppBuildOptions::Profile::Fast;
+    } else if (name == "optimized") {
+        profile = CppBuildOptions::Profile::Optimized;
+    } else if (name == "release") {
+        profile = CppBuildOptions::Profile::Release;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string CppBuilder::cacheKey(const std::string& sourceFile, const std::string& flags) {
+    // The generated code, the runtime it is built with, the flags and the
+    // exact compiler all go into the key; empty if any of them can't be read
+    std::ifstream source(sourceFile);
+    std::string runtime = runtimeSources();
+    std::string version = compilerVersion();
+    if (!source || runtime.empty() || version.empty()) {
+        return "";
+    }
+    std::stringstream data;
+    data << source.rdbuf() << '\0' << runtime << '\0' << flags << '\0' << version;
+    return BuildCache::hashKey(data.str());
+}
+
+std::string CppBuilder::prepareRuntime(const std::string& flags) {
+    std::string runtime = runtimeSources();
+    std::string version = compilerVersion();
+    if (runtime.empty() || version.empty()) {
+        return "";
+    }
+
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::path dir = fs::path(cacheDirectory()) /
+                   ("runtime-" + BuildCache::hashKey(runtime + '\0' + flags + '\0' + version));
+    fs::path library = dir / "libhl_runtime.a";
+    if (fs::exists(library, error)) {
+        // The modification time orders runtimes for eviction like programs
+        fs::last_write_time(dir, fs::file_time_type::clock::now(), error);
+        return dir.string();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    fs::create_directories(dir, error);
+    fs::path header = dir / "hl_pch.hpp";
+    if (!fs::exists(header, error)) {
+        fs::copy_file(fs::path(options.runtimeDir) / "hl_pch.hpp", header, fs::copy_options::overwrite_existing, error);
+    }
+
+    // Outputs get a temporary name and are renamed when complete, so another
+    // build running at the same time never picks up half a file. GCC looks
+    // for hl_pch.hpp.gch next to the forced include, clang for .pch
+    bool clang = version.find("clang") != std::string::npos;
+    std::string suffix = ".tmp" + std::to_string(std::random_device{}());
+    fs::path pch = dir / (clang ? "hl_pch.hpp.pch" : "hl_pch.hpp.gch");
+    fs::path object = dir / ("hl_runtime.o" + suffix);
+    std::string compile = compilerPath() + " " + flags + " -I " + quote(options.runtimeDir);
+    bool built = !error &&
+                 system((compile + " -x c++-header " + quote(header.string()) + " -o " +
+                         quote(pch.string() + suffix)).c_str()) == 0 &&
+                 system((compile + " -c " + quote(options.runtimeDir + "/hl_runtime.cpp") + " -o " +
+                         quote(object.string())).c_str()) == 0 &&
+                 system(("ar rcs " + quote(library.string() + suffix) + " " + quote(object.string())).c_str()) == 0;
+    if (built) {
+        fs::rename(pch.string() + suffix, pch, error);
+        if (!error) {
+            fs::rename(library.string() + suffix, library, error);
+        }
+        built = !error;
+    }
+    fs::remove(object, error);
+    fs::remove(pch.string() + suffix, error);
+    fs::remove(library.string() + suffix, error);
+    runtimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return built ? dir.string() : "";
+}
+
+std::string CppBuilder::runtimeSources() const {
+    std::stringstream sources;
+    for (const char* name : {"hl_runtime.hpp", "hl_runtime.cpp", "hl_pch.hpp", "hl_alloc.hpp"}) {
+        std::ifstream file(options.runtimeDir + "/" + name);
+        if (!file) {
+            return "";
+        }
+        sources << file.rdbuf() << '\0';
+    }
+    return sources.str();
+}
+
+std::string CppBuilder::compilerVersion() {
+    if (!version.empty()) {
+        return version;
+    }
+    FILE* pipe = popen((compilerPath() + " --version 2>/dev/null").c_str(), "r");
+    if (!pipe) {
+        return "";
+    }
+    std::string output;
+    std::array<char, 256> buffer;
+    size_t read;
+    while ((read = fread(buffer.data(), 1, buffer.size(), pipe)) > 0) {
+        output.append(buffer.data(), read);
+    }
+    if (pclose(pipe) == 0) {
+        version = output;
+    }
+    return version;
+}
+
+std::string CppBuilder::cacheDirectory() const {
+    return options.cacheDir.empty() ? BuildCache::defaultDirectory() : options.cacheDir;
+}
+
+std::string CppBuilder::compilerPath() const {
+    if (!options.compiler.empty()) {
+        return options.compiler;
+    }
+    const char* cxx = std::getenv("CXX");
+    return cxx && *cxx ? cxx : "c++";
+}
+
+std::string CppBuilder::profileFlags() const {
+    switch (options.profile) {
+        case CppBuildOptions::Profile::Fast:
+            return "-O0";
+        case CppBuildOptions::Profile::Release:
+            return "-O3 -march=native -flto";
+        case CppBuildOptions::Profile::Optimized:
+        default:
+            return "-O2";
+    }
+}
+
+std::string CppBuilder::quote(const std::string& arg) {
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
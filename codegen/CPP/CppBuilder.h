@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Set by CMake to the source tree's runtime/ directory
+#ifndef HL_RUNTIME_DIR
+#define HL_RUNTIME_DIR "runtime"
+#endif
+
+struct CppBuildOptions {
+    enum class Profile {
+        Fast,       // -O0, quickest to compile
+        Optimized,  // -O2
+        Release     // -O3 -march=native -flto
+    };
+
+    Profile profile = Profile::Optimized;
+    // Empty means $CXX, falling back to c++
+    std::string compiler;
+    std::string outputPath = "output_executable";
+    std::string runtimeDir = HL_RUNTIME_DIR;
+    // Appended after the profile's flags
+    std::string extraFlags;
+
+    // Reuse a binary built earlier from the same code, flags and compiler
+    bool useCache = true;
+    // Compile against a precompiled header and runtime library kept in the
+    // cache directory, built once per compiler and flags
+    bool usePrebuiltRuntime = true;
+    // Empty means BuildCache::defaultDirectory()
+    std::string cacheDir;
+    std::uintmax_t cacheSizeLimit = 512ULL * 1024 * 1024;
+
+    // Profile-guided optimization: when set, the program is built
+    // instrumented, run with this file as stdin, and rebuilt using the
+    // profile, which is kept in profileDir for later builds
+    std::string trainingInput;
+    std::string profileDir = "output.profile";
+};
+
+// Compiles generated C++ with the system compiler, without going through CMake
+class CppBuilder {
+public:
+    explicit CppBuilder(CppBuildOptions options);
+
+    bool build(const std::string& sourceFile);
+    // Path to run the built program with
+    std::string getExecutable() const;
+    std::string getCommand() const;
+    double getBuildSeconds() const;
+    // Time spent preparing the precompiled runtime, zero when it was reused
+    double getRuntimeSeconds() const;
+    // Whether the last build was served from the cache without compiling
+    bool wasCached() const;
+    // Whether the last build ran a training run rather than reusing a profile
+    bool wasTrained() const;
+
+    static bool parseProfile(const std::string& name, CppBuildOptions::Profile& profile);
+
+private:
+    CppBuildOptions options;
+    std::string command;
+    double buildSeconds = 0;
+    bool cached = false;
+    bool trained = false;
+    double runtimeSeconds = 0;
+    std::string version;
+
+    std::string compileCommand(const std::string& sourceFile, const std::string& flags, const std::string& prebuilt,
+                               const std::string& extra = "") const;
+    bool buildWithProfile(const std::string& sourceFile, const std::string& flags, const std::string& prebuilt);
+    std::string cacheKey(const std::string& sourceFile, const std::string& flags);
+    // Directory with hl_pch.hpp, its precompiled form and libhl_runtime.a;
+    // empty if they could not be built
+    std::string prepareRuntime(const std::string& flags);
+    std::string runtimeSources() const;
+    // Output of `<compiler> --version`, empty if it could not be run
+    std::string compilerVersion();
+    std::string cacheDirectory() const;
+    std::string compilerPath() const;
+    std::string profileFlags() const;
+    static std::string quote(const std::string& arg);
+};
@@ -1,26 +1,69 @@
 #include "CppCodeGen.h"
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <unordered_map>
 
+CppCodeGen::CppCodeGen(AllocMode allocMode, bool allocStats) : allocMode(allocMode), allocStats(allocStats) {}
+
 std::string CppCodeGen::generate(std::shared_ptr<Program> program) {
+    bool memoized = false;
+    bool tupleKeys = false;
+    for (const auto& stmt : program->statements) {
+        if (auto funcDef = std::dynamic_pointer_cast<Function>(stmt); funcDef && funcDef->memoize) {
+            memoized = true;
+            tupleKeys = tupleKeys || funcDef->parameters.size() > 1;
+        }
+    }
+
+    parallel = containsParallelLoop(program->statements);
+    bool deques = containsDeque(program->statements);
+
     // Include necessary headers
     codeStream << "#include <iostream>\n";
     codeStream << "#include <string>\n";
-    codeStream << "#include <cctype>\n";
     codeStream << "#include <vector>\n";
+    if (deques) {
+        codeStream << "#include <deque>\n";
+    }
     codeStream << "#include <cmath>\n";
     codeStream << "#include <stdexcept>\n";
-    codeStream << "#include <algorithm>\n";
-    codeStream << "\n";
+    if (memoized) {
+        codeStream << "#include <unordered_map>\n";
+    }
+    if (tupleKeys) {
+        codeStream << "#include <tuple>\n";
+    }
+    if (parallel) {
+        codeStream << "#include <mutex>\n";
+    }
+    codeStream << "#include \"hl_runtime.hpp\"\n\n";
+    codeStream << "static_assert(HL_RUNTIME_VERSION == " << RUNTIME_VERSION
+               << ", \"hl_runtime.hpp does not match the compiler that generated this file\");\n\n";
+    if (allocMode == AllocMode::Arena || allocStats) {
+        // Replaces operator new and delete for the whole program
+        if (allocMode == AllocMode::Arena) {
+            codeStream << "#define HL_ALLOC_ARENA\n";
+        }
+        if (allocStats) {
+            codeStream << "#define HL_ALLOC_STATS\n";
+        }
+        codeStream << "#include \"hl_alloc.hpp\"\n\n";
+    }
 
-    // Safe divide function
-    codeStream << "int safe_divide(int numerator, int denominator) {\n";
-    codeStream << "    if (denominator == 0) {\n";
-    codeStream << "        throw std::runtime_error(\"Division by zero\");\n";
-    codeStream << "    }\n";
-    codeStream << "    return numerator / denominator;\n";
-    codeStream << "}\n\n";
+    // Hash for the tuple keys of memoized functions with several parameters
+    if (tupleKeys) {
+        codeStream << "struct TupleHash {\n";
+        codeStream << "    template <typename... Ts>\n";
+        codeStream << "    size_t operator()(const std::tuple<Ts...>& key) const {\n";
+        codeStream << "        return std::apply([](const auto&... parts) {\n";
+        codeStream << "            size_t seed = 0;\n";
+        codeStream << "            ((seed ^= std::hash<std::decay_t<decltype(parts)>>{}(parts) + 0x9e3779b9 + (seed << 6) + (seed >> 2)), ...);\n";
+        codeStream << "            return seed;\n";
+        codeStream << "        }, key);\n";
+        codeStream << "    }\n";
+        codeStream << "};\n\n";
+    }
 
     // Collect global variable declarations
     std::vector<std::shared_ptr<VarDecl>> globalVars;
@@ -100,20 +143,124 @@ void CppCodeGen::generateFunctionDefinition(const std::shared_ptr<Function>& fun
     if (!returnType) {
         returnType = inferFunctionReturnType(funcDef);
     }
+    std::string name = funcDef->name;
+    if (funcDef->memoize) {
+        // The body is emitted under another name; every call, including the
+        // recursive ones, goes through the caching wrapper declared here
+        generateFunctionSignature(funcDef, returnType, name);
+        codeStream << ";\n\n";
+        name = "__memo_" + name;
+    }
+    generateFunctionSignature(funcDef, returnType, name);
+    codeStream << " {\n";
+    indentLevel++;
+    for (const auto& s : funcDef->body) {
+        generateStatement(s);
+    }
+    indentLevel--;
+    codeStream << "}\n";
+
+    if (funcDef->memoize) {
+        generateMemoWrapper(funcDef, returnType, name);
+    }
+}
+
+void CppCodeGen::generateInPlaceAppend(const std::shared_ptr<Assignment>& assignment) {
+    // s = s + a + b  becomes  (s += a) += b, likewise for s = s.concat(a)
+    std::vector<ExprPtr> parts;
+    ExprPtr node = assignment->value;
+    while (!std::dynamic_pointer_cast<Identifier>(node)) {
+        if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(node)) {
+            parts.insert(parts.begin(), binaryOp->right);
+            node = binaryOp->left;
+        } else {
+            auto call = std::dynamic_pointer_cast<FunctionCall>(node);
+            parts.insert(parts.begin(), call->arguments[0]);
+            node = std::dynamic_pointer_cast<MemberAccess>(call->callee)->object;
+        }
+    }
+    codeStream << std::string(parts.size() - 1, '(');
+    generateExpression(assignment->target);
+    for (size_t i = 0; i < parts.size(); ++i) {
+        codeStream << " += ";
+        generateExpression(parts[i]);
+        if (i < parts.size() - 1) {
+            codeStream << ")";
+        }
+    }
+}
+
+void CppCodeGen::generateFunctionSignature(const std::shared_ptr<Function>& funcDef, const TypePtr& returnType,
+                                           const std::string& name) {
     generateType(returnType);
-    codeStream << " " << funcDef->name << "(";
+    codeStream << " " << name << "(";
     for (size_t i = 0; i < funcDef->parameters.size(); ++i) {
+        bool constRef = i < funcDef->constRefParams.size() && funcDef->constRefParams[i];
+        if (constRef) {
+            codeStream << "const ";
+        }
         generateType(funcDef->parameters[i].first);
-        codeStream << " " << funcDef->parameters[i].second;
+        codeStream << (constRef ? "& " : " ") << funcDef->parameters[i].second;
         if (i < funcDef->parameters.size() - 1) {
             codeStream << ", ";
         }
     }
-    codeStream << ") {\n";
+    codeStream << ")";
+}
+
+void CppCodeGen::generateMemoWrapper(const std::shared_ptr<Function>& funcDef, const TypePtr& returnType,
+                                     const std::string& implName) {
+    const auto& params = funcDef->parameters;
+    bool tupleKey = params.size() > 1;
+
+    codeStream << "\n";
+    generateFunctionSignature(funcDef, returnType, funcDef->name);
+    codeStream << " {\n";
     indentLevel++;
-    for (const auto& s : funcDef->body) {
-        generateStatement(s);
+
+    // Results are cached by argument values, keyed by a tuple for several
+    // parameters; one cache per thread when parallel loops may call in
+    indent();
+    codeStream << (parallel ? "thread_local" : "static") << " std::unordered_map<";
+    if (tupleKey) {
+        codeStream << "std::tuple<";
+        for (size_t i = 0; i < params.size(); ++i) {
+            generateType(params[i].first);
+            if (i < params.size() - 1) {
+                codeStream << ", ";
+            }
+        }
+        codeStream << ">";
+    } else {
+        generateType(params[0].first);
     }
+    codeStream << ", ";
+    generateType(returnType);
+    codeStream << (tupleKey ? ", TupleHash" : "") << "> __cache;\n";
+
+    std::string arguments;
+    for (size_t i = 0; i < params.size(); ++i) {
+        arguments += (i > 0 ? ", " : "") + params[i].second;
+    }
+    indent();
+    codeStream << "auto __key = " << (tupleKey ? "std::make_tuple(" + arguments + ")" : arguments) << ";\n";
+    indent();
+    codeStream << "auto __cached = __cache.find(__key);\n";
+    indent();
+    codeStream << "if (__cached != __cache.end()) {\n";
+    indentLevel++;
+    indent();
+    codeStream << "return __cached->second;\n";
+    indentLevel--;
+    indent();
+    codeStream << "}\n";
+    indent();
+    generateType(returnType);
+    codeStream << " __result = " << implName << "(" << arguments << ");\n";
+    indent();
+    codeStream << "__cache.emplace(__key, __result);\n";
+    indent();
+    codeStream << "return __result;\n";
     indentLevel--;
     codeStream << "}\n";
 }
@@ -125,11 +272,26 @@ void CppCodeGen::generateStatement(const StmtPtr& stmt) {
         codeStream << ";\n";
     } else if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
         indent();
-        if (varDecl->isConst) {
+        if (varDecl->isConst || varDecl->bindReference) {
             codeStream << "const ";
         }
-        generateType(varDecl->type);
-        codeStream << " " << varDecl->name;
+        if (varDecl->container == VarDecl::Container::Deque ||
+            varDecl->container == VarDecl::Container::DequeCppOnly) {
+            // A list used as a queue; its methods are emitted the same way,
+            // but inserting and erasing at the front no longer shift it
+            codeStream << "std::deque<";
+            generateType(varDecl->type->elementType);
+            codeStream << ">";
+        } else if (varDecl->container == VarDecl::Container::Array ||
+                   varDecl->container == VarDecl::Container::SmallVector) {
+            // A short list kept on the stack
+            codeStream << (varDecl->container == VarDecl::Container::Array ? "std::array<" : "hl::small_vector<");
+            generateType(varDecl->type->elementType);
+            codeStream << ", " << varDecl->capacity << ">";
+        } else {
+            generateType(varDecl->type);
+        }
+        codeStream << (varDecl->bindReference ? "& " : " ") << varDecl->name;
         if (varDecl->initializer) {
             codeStream << " = ";
             generateExpression(varDecl->initializer);
@@ -194,50 +356,7 @@ void CppCodeGen::generateStatement(const StmtPtr& stmt) {
         indent();
         codeStream << "}\n";
     } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
-        indent();
-        codeStream << "{\n";
-        indentLevel++;
-
-        // Initialize start, end, and step
-        indent();
-        codeStream << "int __start = ";
-        generateExpression(forStmt->start);
-        codeStream << ";\n";
-
-        indent();
-        codeStream << "int __end = ";
-        generateExpression(forStmt->end);
-        codeStream << ";\n";
-
-        indent();
-        codeStream << "int __step = ";
-        if (forStmt->step) {
-            codeStream << "(__start > __end ? -(";
-            generateExpression(forStmt->step);
-            codeStream << ") : (";
-            generateExpression(forStmt->step);
-            codeStream << "));\n";
-            indent();
-            codeStream << "if (__step == 0) throw std::runtime_error(\"For loop step cannot be zero.\");\n";
-        } else {
-            codeStream << "(__start < __end ? 1 : -1);\n";  // Default to 1 or -1 based on start and end
-        }
-
-        indent();
-        codeStream << "for (int " << forStmt->iterator << " = __start; "
-                   << "(__step > 0 ? " << forStmt->iterator << " < __end : " << forStmt->iterator << " > __end); "
-                   << forStmt->iterator << " += __step) {\n";
-        indentLevel++;
-        for (const auto& s : forStmt->body) {
-            generateStatement(s);
-        }
-        indentLevel--;
-        indent();
-        codeStream << "}\n";
-
-        indentLevel--;
-        indent();
-        codeStream << "}\n"; // Close the scope
+        generateForLoop(forStmt);
     } else if (auto returnStmt = std::dynamic_pointer_cast<Return>(stmt)) {
         indent();
         codeStream << "return";
@@ -265,9 +384,10 @@ void CppCodeGen::generateStatement(const StmtPtr& stmt) {
         codeStream << "}\n";
     } else if (auto printStmt = std::dynamic_pointer_cast<Print>(stmt)) {
         indent();
-        codeStream << "std::cout << ";
+        // Buffered by the runtime rather than flushed line by line
+        codeStream << "hl::print(";
         generateExpression(printStmt->expression);
-        codeStream << " << std::endl;\n";
+        codeStream << ");\n";
     } else {
         // other statement types
     }
@@ -288,6 +408,11 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
         } else if (std::holds_alternative<bool>(literal->value)) {
             codeStream << (std::get<bool>(literal->value) ? "true" : "false");
         } else if (std::holds_alternative<std::vector<ExprPtr>>(literal->value)) {
+            // A matrix literal names its type, so it is never taken for a
+            // (rows, cols) pair
+            if (literal->type && literal->type->kind == Type::Kind::MATRIX) {
+                generateType(literal->type);
+            }
             codeStream << "{";
             const auto& elements = std::get<std::vector<ExprPtr>>(literal->value);
             for (size_t i = 0; i < elements.size(); ++i) {
@@ -304,10 +429,14 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
         if (name == "main") {
             name = "hl_main";
         }
-        codeStream << name;
+        if (ident->lastUse) {
+            codeStream << "std::move(" << name << ")";
+        } else {
+            codeStream << name;
+        }
     } else if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
-        if (binaryOp->op == BinaryOp::Operator::DIV) {
-            codeStream << "safe_divide(";
+        if (binaryOp->op == BinaryOp::Operator::DIV && !binaryOp->nonZeroDivisor) {
+            codeStream << "hl::safe_divide(";
             generateExpression(binaryOp->left);
             codeStream << ", ";
             generateExpression(binaryOp->right);
@@ -345,35 +474,18 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
                 codeStream << " + ";
                 generateExpression(funcCall->arguments[0]);
             } else if (memberAccess->memberName == "toUpper" || memberAccess->memberName == "toLower") {
-                if (memberAccess->memberName == "toUpper") {
-                    // Convert string to uppercase using std::transform and std::toupper
-                    codeStream << "([&]() { std::string temp = ";
-                    generateExpression(memberAccess->object);
-                    codeStream << "; std::transform(temp.begin(), temp.end(), temp.begin(), [](unsigned char c) { return std::toupper(c); }); return temp; })()";
-                } else if (memberAccess->memberName == "toLower") {
-                    // Convert string to lowercase using std::transform and std::tolower
-                    codeStream << "([&]() { std::string temp = ";
-                    generateExpression(memberAccess->object);
-                    codeStream << "; std::transform(temp.begin(), temp.end(), temp.begin(), [](unsigned char c) { return std::tolower(c); }); return temp; })()";
-                }
+                codeStream << (memberAccess->memberName == "toUpper" ? "hl::to_upper(" : "hl::to_lower(");
+                generateExpression(memberAccess->object);
+                codeStream << ")";
             } else if (memberAccess->memberName == "sub") {
-                codeStream << "([&]() {\n";
-                codeStream << "    std::string temp = ";
-                generateExpression(memberAccess->object); // The original string
-                codeStream << ";\n";
-                codeStream << "    std::string oldVal = ";
-                generateExpression(funcCall->arguments[0]); // The old substring
-                codeStream << ";\n";
-                codeStream << "    std::string newVal = ";
-                generateExpression(funcCall->arguments[1]); // The new substring
-                codeStream << ";\n";
-                codeStream << "    size_t pos = 0;\n";
-                codeStream << "    while ((pos = temp.find(oldVal, pos)) != std::string::npos) {\n";
-                codeStream << "        temp.replace(pos, oldVal.length(), newVal);\n";
-                codeStream << "        pos += newVal.length(); // Advance past the new substring\n";
-                codeStream << "    }\n";
-                codeStream << "    return temp;\n";
-                codeStream << "})()";
+                // Replace every occurrence of the first argument with the second
+                codeStream << "hl::str_replace_all(";
+                generateExpression(memberAccess->object);
+                codeStream << ", ";
+                generateExpression(funcCall->arguments[0]);
+                codeStream << ", ";
+                generateExpression(funcCall->arguments[1]);
+                codeStream << ")";
             } else if (memberAccess->memberName == "append") {
                 generateExpression(memberAccess->object);
                 codeStream << ".push_back(";
@@ -396,6 +508,26 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
             } else if (memberAccess->memberName == "empty") {
                 generateExpression(memberAccess->object);
                 codeStream << ".clear()";
+            } else if (memberAccess->memberName == "sum" || memberAccess->memberName == "min" ||
+                       memberAccess->memberName == "max" || memberAccess->memberName == "dot" ||
+                       memberAccess->memberName == "scale" || memberAccess->memberName == "add") {
+                // Vectorized list kernels in the runtime
+                codeStream << "hl::list_" << memberAccess->memberName << "(";
+                generateExpression(memberAccess->object);
+                if (!funcCall->arguments.empty()) {
+                    codeStream << ", ";
+                    generateExpression(funcCall->arguments[0]);
+                }
+                codeStream << ")";
+            } else if (memberAccess->memberName == "rows" || memberAccess->memberName == "cols") {
+                generateExpression(memberAccess->object);
+                codeStream << "." << memberAccess->memberName << "()";
+            } else if (memberAccess->memberName == "matmul") {
+                codeStream << "hl::matmul(";
+                generateExpression(memberAccess->object);
+                codeStream << ", ";
+                generateExpression(funcCall->arguments[0]);
+                codeStream << ")";
             } else if (memberAccess->memberName == "power") {
                 // Generate code for power function
                 if (funcCall->arguments.size() == 1) {
@@ -429,19 +561,19 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
                 codeStream << ")";
             } if (memberAccess->memberName == "fact") {
                 // Factorial
-                codeStream << "([&]() { return static_cast<int>(std::tgamma(";
+                codeStream << "hl::fact(";
                 generateExpression(memberAccess->object); // `a`
-                codeStream << "+ 1)); })()";
+                codeStream << ")";
             } else if (memberAccess->memberName == "isEven") {
                 // Check if even
-                codeStream << "([&]() { return (";
+                codeStream << "hl::is_even(";
                 generateExpression(memberAccess->object); // `a`
-                codeStream << " % 2 == 0); })()";
+                codeStream << ")";
             } else if (memberAccess->memberName == "toBinary") {
                 // Convert to binary and return as int
-                codeStream << "([&]() { std::string binary; int n = ";
+                codeStream << "hl::to_binary(";
                 generateExpression(memberAccess->object); // e.g., 'a'
-                codeStream << "; do { binary = std::to_string(n % 2) + binary; n /= 2; } while (n > 0); return static_cast<int>(std::stol(binary)); })()";
+                codeStream << ")";
             } else {
                 // Other member functions
             }
@@ -451,15 +583,29 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
                 name = "hl_main";
             }
 
-            if (name == "input") {
-                // Generate standard C++ code for input
-                codeStream << "([&]() -> std::string { std::string tempInput; std::cout << ";
+            if (name == "zeros") {
+                // The semantic analyzer gave it the matrix type it initializes
+                generateType(funcCall->type);
+                codeStream << "(";
+                generateExpression(funcCall->arguments[0]);
+                codeStream << ", ";
+                generateExpression(funcCall->arguments[1]);
+                codeStream << ")";
+            } else if (name == "input") {
+                // Prompt and read a line from standard input
+                codeStream << "hl::input(";
                 generateExpression(funcCall->arguments[0]);
-                codeStream << "; std::getline(std::cin, tempInput); return tempInput; })()";
+                codeStream << ")";
+            } else if (name == "flush") {
+                codeStream << "hl::flush()";
+            } else if (name == "readInts") {
+                codeStream << "hl::read_ints()";
+            } else if (name == "readLines") {
+                codeStream << "hl::read_lines()";
             } else if (name == "INT") {
                 TypePtr argType = funcCall->arguments[0]->type;
                 if (argType->kind == Type::Kind::STRING) {
-                    codeStream << "std::stoi(";
+                    codeStream << "hl::to_int(";
                     generateExpression(funcCall->arguments[0]);
                     codeStream << ")";
                 }
@@ -495,7 +641,7 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
                 }
             }
             else if (name == "STR") {
-                codeStream << "std::to_string(";
+                codeStream << "hl::str(";
                 generateExpression(funcCall->arguments[0]);
                 codeStream << ")";
             } else {
@@ -525,6 +671,10 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
         generateExpression(memberAccess->object);
         codeStream << "." << memberAccess->memberName;
     } else if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        if (assignment->appendInPlace) {
+            generateInPlaceAppend(assignment);
+            return;
+        }
         generateExpression(assignment->target);
         codeStream << " = ";
         generateExpression(assignment->value);
@@ -535,7 +685,14 @@ void CppCodeGen::generateExpression(const ExprPtr& expr) {
         codeStream << "]";
     } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
         codeStream << (unaryOp->op == UnaryOp::Operator::NOT ? "!" : "-");
-        generateExpression(unaryOp->operand);
+        // Nested negations would otherwise print as the -- operator
+        if (std::dynamic_pointer_cast<UnaryOp>(unaryOp->operand)) {
+            codeStream << "(";
+            generateExpression(unaryOp->operand);
+            codeStream << ")";
+        } else {
+            generateExpression(unaryOp->operand);
+        }
     } else {
         // Other expressions
     }
@@ -560,6 +717,11 @@ void CppCodeGen::generateType(const TypePtr& type) {
             generateType(type->elementType);
             codeStream << ">";
             break;
+        case Type::Kind::MATRIX:
+            codeStream << "hl::matrix<";
+            generateType(type->elementType);
+            codeStream << ">";
+            break;
         case Type::Kind::VOID:
             codeStream << "void";
             break;
@@ -584,6 +746,8 @@ std::string CppCodeGen::getOperatorString(BinaryOp::Operator op) {
         case BinaryOp::Operator::GE:  return ">=";
         case BinaryOp::Operator::AND: return "&&";
         case BinaryOp::Operator::OR:  return "||";
+        case BinaryOp::Operator::SHR: return ">>";
+        case BinaryOp::Operator::BITAND: return "&";
         default: return "";
     }
 }
@@ -602,9 +766,360 @@ TypePtr CppCodeGen::inferFunctionReturnType(const std::shared_ptr<Function>& fun
             }
         }
     }
+    // e.g. a recursive function the optimizer turned into a loop
+    if (TypePtr nested = findNestedReturnType(funcDef->body)) {
+        return nested;
+    }
     return std::make_shared<Type>(Type::Kind::VOID);
 }
 
+void CppCodeGen::generateForLoop(const std::shared_ptr<For>& forStmt) {
+    if (forStmt->parallel) {
+        generateParallelForLoop(forStmt);
+        return;
+    }
+    const std::string& it = forStmt->iterator;
+    indent();
+    codeStream << "{\n";
+    indentLevel++;
+
+    // Initialize start, end, and step
+    indent();
+    codeStream << "const int __start = ";
+    generateExpression(forStmt->start);
+    codeStream << ";\n";
+
+    indent();
+    codeStream << "const int __end = ";
+    generateExpression(forStmt->end);
+    codeStream << ";\n";
+
+    // The loop runs upwards unless start > end, by `step` (default 1). With
+    // no step or a positive constant one, that is a plain counted loop the
+    // C++ compiler can analyze and vectorize, instead of one whose condition
+    // and stride are picked at run time
+    auto step = std::dynamic_pointer_cast<Literal>(forStmt->step);
+    int stepValue = step && std::holds_alternative<int>(step->value) ? std::get<int>(step->value) : 0;
+    if (!forStmt->step || stepValue > 0) {
+        if (!forStmt->reservedLists.empty()) {
+            // Each iteration appends to these lists, so they grow by the trip count
+            std::string distance = "__start <= __end ? (long long)__end - __start : (long long)__start - __end";
+            if (stepValue > 1) {
+                distance = "((" + distance + ") + " + std::to_string(stepValue - 1) + ") / " + std::to_string(stepValue);
+            }
+            indent();
+            codeStream << "const size_t __trips = static_cast<size_t>(" << distance << ");\n";
+            for (const auto& name : forStmt->reservedLists) {
+                indent();
+                codeStream << name << ".reserve(" << name << ".size() + __trips);\n";
+            }
+        }
+        std::string increment = stepValue > 1 ? " += " + std::to_string(stepValue) : "";
+        std::string decrement = stepValue > 1 ? " -= " + std::to_string(stepValue) : "";
+        int direction = forDirection(forStmt);
+        // Only innermost loops are versioned on the direction, so the body
+        // is never emitted more than twice
+        if (direction == 0 && containsForLoop(forStmt->body)) {
+            generateGenericForLoop(forStmt);
+        } else if (direction != 0) {
+            indent();
+            codeStream << "for (int " << it << " = __start; " << it << (direction > 0 ? " < " : " > ") << "__end; "
+                       << (stepValue > 1 ? it + (direction > 0 ? increment : decrement)
+                                         : (direction > 0 ? "++" : "--") + it)
+                       << ") {\n";
+            generateBlock(forStmt->body);
+        } else {
+            indent();
+            codeStream << "if (__start <= __end) {\n";
+            indentLevel++;
+            indent();
+            codeStream << "for (int " << it << " = __start; " << it << " < __end; "
+                       << (stepValue > 1 ? it + increment : "++" + it) << ") {\n";
+            generateBlock(forStmt->body);
+            indentLevel--;
+            indent();
+            codeStream << "} else {\n";
+            indentLevel++;
+            indent();
+            codeStream << "for (int " << it << " = __start; " << it << " > __end; "
+                       << (stepValue > 1 ? it + decrement : "--" + it) << ") {\n";
+            generateBlock(forStmt->body);
+            indentLevel--;
+            indent();
+            codeStream << "}\n";
+        }
+    } else {
+        generateGenericForLoop(forStmt);
+    }
+
+    indentLevel--;
+    indent();
+    codeStream << "}\n"; // Close the scope
+}
+
+void CppCodeGen::generateParallelForLoop(const std::shared_ptr<For>& forStmt) {
+    // The iterations are numbered 0..__count and handed to the runtime's
+    // thread pool in chunks. Each chunk accumulates its own copy of every
+    // reduction variable and adds it into the shared one under a lock
+    auto step = std::dynamic_pointer_cast<Literal>(forStmt->step);
+    std::string stepValue = step && std::holds_alternative<int>(step->value)
+                                ? std::to_string(std::get<int>(step->value)) : "1";
+    indent();
+    codeStream << "{\n";
+    indentLevel++;
+
+    indent();
+    codeStream << "const int __start = ";
+    generateExpression(forStmt->start);
+    codeStream << ";\n";
+    indent();
+    codeStream << "const int __end = ";
+    generateExpression(forStmt->end);
+    codeStream << ";\n";
+    indent();
+    codeStream << "const int __step = __start <= __end ? " << stepValue << " : -" << stepValue << ";\n";
+    indent();
+    codeStream << "const long long __count = ((long long)__end - __start + __step + (__step > 0 ? -1 : 1)) / __step;\n";
+    if (!forStmt->reductions.empty()) {
+        indent();
+        codeStream << "std::mutex __reduce_lock;\n";
+    }
+    for (const auto& reduction : forStmt->reductions) {
+        indent();
+        codeStream << "auto* __out_" << reduction.second << " = &" << reduction.second << ";\n";
+    }
+
+    indent();
+    codeStream << "hl::parallel_for(__count, [&](long long __first, long long __last) {\n";
+    indentLevel++;
+    for (const auto& [op, name] : forStmt->reductions) {
+        // A maximum or minimum starts from the value before the loop
+        indent();
+        codeStream << "decltype(" << name << ") " << name << " = ";
+        if (op == BinaryOp::Operator::GT || op == BinaryOp::Operator::LT) {
+            codeStream << "*__out_" << name << ";\n";
+        } else {
+            codeStream << (op == BinaryOp::Operator::MUL ? 1 : 0) << ";\n";
+        }
+    }
+    indent();
+    codeStream << "for (long long __k = __first; __k < __last; ++__k) {\n";
+    indentLevel++;
+    indent();
+    codeStream << "int " << forStmt->iterator << " = static_cast<int>(__start + __k * __step);\n";
+    indentLevel--;
+    generateBlock(forStmt->body);
+    if (!forStmt->reductions.empty()) {
+        indent();
+        codeStream << "std::lock_guard<std::mutex> __guard(__reduce_lock);\n";
+    }
+    for (const auto& [op, name] : forStmt->reductions) {
+        indent();
+        if (op == BinaryOp::Operator::GT || op == BinaryOp::Operator::LT) {
+            codeStream << "if (" << name << (op == BinaryOp::Operator::GT ? " > " : " < ") << "*__out_" << name
+                       << ") *__out_" << name << " = " << name << ";\n";
+        } else {
+            codeStream << "*__out_" << name << (op == BinaryOp::Operator::MUL ? " *= " : " += ") << name << ";\n";
+        }
+    }
+    indentLevel--;
+    indent();
+    codeStream << "}";
+    // Loops parallelized by the optimizer stay on one thread when short
+    if (forStmt->minParallelTrips > 0) {
+        codeStream << ", " << forStmt->minParallelTrips;
+    }
+    codeStream << ");\n";
+
+    indentLevel--;
+    indent();
+    codeStream << "}\n";
+}
+
+void CppCodeGen::generateGenericForLoop(const std::shared_ptr<For>& forStmt) {
+    indent();
+    codeStream << "int __step = ";
+    if (forStmt->step) {
+        codeStream << "(__start > __end ? -(";
+        generateExpression(forStmt->step);
+        codeStream << ") : (";
+        generateExpression(forStmt->step);
+        codeStream << "));\n";
+        indent();
+        codeStream << "if (__step == 0) throw std::runtime_error(\"For loop step cannot be zero.\");\n";
+    } else {
+        codeStream << "(__start < __end ? 1 : -1);\n";  // Default to 1 or -1 based on start and end
+    }
+
+    indent();
+    codeStream << "for (int " << forStmt->iterator << " = __start; "
+               << "(__step > 0 ? " << forStmt->iterator << " < __end : " << forStmt->iterator << " > __end); "
+               << forStmt->iterator << " += __step) {\n";
+    generateBlock(forStmt->body);
+}
+
+void CppCodeGen::generateBlock(const std::vector<StmtPtr>& body) {
+    // Emits the statements and the closing brace of an already opened block
+    indentLevel++;
+    for (const auto& s : body) {
+        generateStatement(s);
+    }
+    indentLevel--;
+    indent();
+    codeStream << "}\n";
+}
+
+int CppCodeGen::forDirection(const std::shared_ptr<For>& forStmt) {
+    // 1 when the loop provably runs upwards (or not at all), -1 downwards,
+    // 0 when it depends on run-time values
+    auto constant = [](const ExprPtr& expr) -> std::optional<int> {
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            if (std::holds_alternative<int>(literal->value)) {
+                return std::get<int>(literal->value);
+            }
+        } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+            auto literal = std::dynamic_pointer_cast<Literal>(unaryOp->operand);
+            if (unaryOp->op == UnaryOp::Operator::MINUS && literal && std::holds_alternative<int>(literal->value)) {
+                return -std::get<int>(literal->value);
+            }
+        }
+        return std::nullopt;
+    };
+    auto start = constant(forStmt->start);
+    auto end = constant(forStmt->end);
+    if (start && end) {
+        return *start > *end ? -1 : 1;
+    }
+    // (i, 0, xs.length()) and the like: a length is never negative
+    auto call = std::dynamic_pointer_cast<FunctionCall>(forStmt->end);
+    auto member = call ? std::dynamic_pointer_cast<MemberAccess>(call->callee) : nullptr;
+    if (start && *start <= 0 && member && member->memberName == "length") {
+        return 1;
+    }
+    return 0;
+}
+
+bool CppCodeGen::containsForLoop(const std::vector<StmtPtr>& block) {
+    for (const auto& stmt : block) {
+        if (std::dynamic_pointer_cast<For>(stmt)) {
+            return true;
+        }
+        std::vector<const std::vector<StmtPtr>*> nested;
+        if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            nested.push_back(&ifStmt->thenBlock);
+            for (const auto& elif : ifStmt->elifBlocks) {
+                nested.push_back(&elif.second);
+            }
+            nested.push_back(&ifStmt->elseBlock);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            nested.push_back(&whileStmt->body);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            nested.push_back(&tryCatch->tryBlock);
+            nested.push_back(&tryCatch->catchBlock);
+        }
+        for (const auto* inner : nested) {
+            if (containsForLoop(*inner)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CppCodeGen::containsDeque(const std::vector<StmtPtr>& block) {
+    for (const auto& stmt : block) {
+        std::vector<const std::vector<StmtPtr>*> nested;
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            if (varDecl->container == VarDecl::Container::Deque ||
+                varDecl->container == VarDecl::Container::DequeCppOnly) {
+                return true;
+            }
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            nested.push_back(&forStmt->body);
+        } else if (auto funcDef = std::dynamic_pointer_cast<Function>(stmt)) {
+            nested.push_back(&funcDef->body);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            nested.push_back(&ifStmt->thenBlock);
+            for (const auto& elif : ifStmt->elifBlocks) {
+                nested.push_back(&elif.second);
+            }
+            nested.push_back(&ifStmt->elseBlock);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            nested.push_back(&whileStmt->body);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            nested.push_back(&tryCatch->tryBlock);
+            nested.push_back(&tryCatch->catchBlock);
+        }
+        for (const auto* inner : nested) {
+            if (containsDeque(*inner)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CppCodeGen::containsParallelLoop(const std::vector<StmtPtr>& block) {
+    for (const auto& stmt : block) {
+        std::vector<const std::vector<StmtPtr>*> nested;
+        if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            if (forStmt->parallel) {
+                return true;
+            }
+            nested.push_back(&forStmt->body);
+        } else if (auto funcDef = std::dynamic_pointer_cast<Function>(stmt)) {
+            nested.push_back(&funcDef->body);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            nested.push_back(&ifStmt->thenBlock);
+            for (const auto& elif : ifStmt->elifBlocks) {
+                nested.push_back(&elif.second);
+            }
+            nested.push_back(&ifStmt->elseBlock);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            nested.push_back(&whileStmt->body);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            nested.push_back(&tryCatch->tryBlock);
+            nested.push_back(&tryCatch->catchBlock);
+        }
+        for (const auto* inner : nested) {
+            if (containsParallelLoop(*inner)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+TypePtr CppCodeGen::findNestedReturnType(const std::vector<StmtPtr>& block) {
+    for (const auto& stmt : block) {
+        std::vector<const std::vector<StmtPtr>*> nested;
+        if (auto returnStmt = std::dynamic_pointer_cast<Return>(stmt)) {
+            if (returnStmt->value && returnStmt->value->type) {
+                return returnStmt->value->type;
+            }
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            nested.push_back(&ifStmt->thenBlock);
+            for (const auto& elif : ifStmt->elifBlocks) {
+                nested.push_back(&elif.second);
+            }
+            nested.push_back(&ifStmt->elseBlock);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            nested.push_back(&whileStmt->body);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            nested.push_back(&forStmt->body);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            nested.push_back(&tryCatch->tryBlock);
+            nested.push_back(&tryCatch->catchBlock);
+        }
+        for (const auto* inner : nested) {
+            if (TypePtr type = findNestedReturnType(*inner)) {
+                return type;
+            }
+        }
+    }
+    return nullptr;
+}
+
 void CppCodeGen::writeToFile(const std::string& filename, const std::string& code) {
     std::ofstream file(filename);
     if (file.is_open()) {
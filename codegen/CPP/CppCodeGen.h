@@ -5,8 +5,17 @@
 #include <sstream>
 #include "../../ast/AST.h"
 
+// How generated programs allocate memory (--alloc)
+enum class AllocMode {
+    System,  // the C++ library's operator new
+    Arena    // the size-class arena in runtime/hl_alloc.hpp
+};
+
 class CppCodeGen {
 public:
+    // allocStats: the program reports its allocations at exit
+    explicit CppCodeGen(AllocMode allocMode = AllocMode::System, bool allocStats = false);
+
     std::string generate(std::shared_ptr<Program> program);
 
     void generateSafeNegate(const ExprPtr &expr);
@@ -14,6 +23,9 @@ public:
     void writeToFile(const std::string& filename, const std::string& code);
 
 private:
+    // Must match HL_RUNTIME_VERSION in runtime/hl_runtime.hpp
+    static constexpr int RUNTIME_VERSION = 9;
+
     std::stringstream codeStream;
 
     // Helper methods
@@ -21,6 +33,15 @@ private:
     void generateExpression(const ExprPtr& expr);
     void generateType(const TypePtr& type);
     void generateFunctionDefinition(const std::shared_ptr<Function>& funcDef);
+    void generateFunctionSignature(const std::shared_ptr<Function>& funcDef, const TypePtr& returnType,
+                                   const std::string& name);
+    void generateForLoop(const std::shared_ptr<For>& forStmt);
+    void generateGenericForLoop(const std::shared_ptr<For>& forStmt);
+    void generateParallelForLoop(const std::shared_ptr<For>& forStmt);
+    void generateBlock(const std::vector<StmtPtr>& body);
+    void generateInPlaceAppend(const std::shared_ptr<Assignment>& assignment);
+    void generateMemoWrapper(const std::shared_ptr<Function>& funcDef, const TypePtr& returnType,
+                             const std::string& implName);
 
     // Utility methods
     std::string getOperatorString(BinaryOp::Operator op);
@@ -28,7 +49,16 @@ private:
     void indent();
     bool isNegativeLiteral(const ExprPtr& expr);
     TypePtr inferFunctionReturnType(const std::shared_ptr<Function>& funcDef);
+    TypePtr findNestedReturnType(const std::vector<StmtPtr>& block);
+    int forDirection(const std::shared_ptr<For>& forStmt);
+    bool containsForLoop(const std::vector<StmtPtr>& block);
+    bool containsParallelLoop(const std::vector<StmtPtr>& block);
+    bool containsDeque(const std::vector<StmtPtr>& block);
 
     // Indentation level
     int indentLevel = 1;
+    // The program has `parallel for` loops, so generated code must be thread safe
+    bool parallel = false;
+    AllocMode allocMode;
+    bool allocStats;
 };
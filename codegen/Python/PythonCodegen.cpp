@@ -11,7 +11,10 @@ const std::unordered_map<std::string, std::string> PythonCodeGen::builtinFunctio
     {"remove", "pop"},
     {"empty", "clear"},
     {"STR", "str"},
-    {"input", "input"},
+    {"input", "_hl_input"},
+    {"flush", "_hl_flush"},
+    {"readInts", "_hl_read_ints"},
+    {"readLines", "_hl_read_lines"},
     {"INT", "int"},
     {"FLOAT", "float"},
     {"toUpper", "upper"},
@@ -19,6 +22,79 @@ const std::unordered_map<std::string, std::string> PythonCodeGen::builtinFunctio
     {"sub", "replace"},
 };
 
+// Helpers for the list methods `dot`, `scale` and `add`. map() with the
+// operator functions runs the element loop in C; converting to NumPy arrays
+// and back costs more than it saves on Python lists
+const std::string PythonCodeGen::listKernels = R"(import operator
+
+def _hl_check_lengths(name, xs, ys):
+    if len(xs) != len(ys):
+        raise ValueError(name + "() of lists with different lengths")
+
+def _hl_dot(xs, ys):
+    _hl_check_lengths("dot", xs, ys)
+    return sum(map(operator.mul, xs, ys))
+
+def _hl_scale(xs, k):
+    return [x * k for x in xs]
+
+def _hl_add(xs, ys):
+    _hl_check_lengths("add", xs, ys)
+    return list(map(operator.add, xs, ys))
+
+)";
+
+// `print` appends to a list that is written with one sys.stdout.write call
+// per few thousand lines, which is much cheaper than print() per line. It is
+// written out before input() prompts, on flush() and at exit, and after
+// every line when standard output is a terminal. input() behaves like the
+// builtin but reads with sys.stdin.readline(), which is several times faster.
+// readInts() and readLines() read the rest of standard input at once, through
+// sys.stdin rather than sys.stdin.buffer, which would miss text sys.stdin has
+// already buffered
+const std::string PythonCodeGen::ioHelpers = R"(import atexit
+import sys
+
+_hl_out = []
+_hl_terminal = sys.stdout.isatty()
+
+def _hl_flush():
+    if _hl_out:
+        _hl_out.append("")
+        sys.stdout.write("\n".join(_hl_out))
+        _hl_out.clear()
+    sys.stdout.flush()
+
+def _hl_print(value):
+    _hl_out.append(str(value))
+    if _hl_terminal or len(_hl_out) >= 8192:
+        _hl_flush()
+
+def _hl_input(prompt):
+    if _hl_out or prompt:
+        _hl_flush()
+        sys.stdout.write(prompt)
+        sys.stdout.flush()
+    line = sys.stdin.readline()
+    if not line:
+        raise EOFError("EOF when reading a line")
+    return line[:-1] if line.endswith("\n") else line
+
+def _hl_read_ints():
+    _hl_flush()
+    return list(map(int, sys.stdin.read().split()))
+
+def _hl_read_lines():
+    _hl_flush()
+    lines = sys.stdin.read().split("\n")
+    if lines[-1] == "":
+        lines.pop()
+    return lines
+
+atexit.register(_hl_flush)
+
+)";
+
 // Helper methods for indentation
 void PythonCodeGen::indent() {
     ++indentLevel;
@@ -41,14 +117,35 @@ std::string PythonCodeGen::generate(const std::shared_ptr<Program>& program) {
     output << "# Generated Python code\n";
     output << "from typing import List, Any\n\n";
     output << "import math\n\n";
+    for (const auto& stmt : program->statements) {
+        auto func = std::dynamic_pointer_cast<Function>(stmt);
+        if (func && func->memoize) {
+            output << "import functools\n\n";
+            break;
+        }
+    }
 
     // Generating program statements
+    std::string header = output.str();
+    output.str("");
     for (const auto& stmt : program->statements) {
         generateStatement(stmt);
         output << "\n";
     }
 
-    return output.str();
+    if (usesNumpy) {
+        header += "import numpy as np\n\n";
+    }
+    if (usesDeques) {
+        header += "import collections\n\n";
+    }
+    if (usesListKernels) {
+        header += listKernels;
+    }
+    if (usesIO) {
+        header += ioHelpers;
+    }
+    return header + output.str();
 }
 
 // single statement
@@ -97,7 +194,13 @@ void PythonCodeGen::generateStatement(const StmtPtr& stmt) {
 // variable declaration
 void PythonCodeGen::generateVarDecl(const std::shared_ptr<VarDecl>& varDecl) {
     output << currentIndent << varDecl->name << " = ";
-    if (varDecl->initializer) {
+    if (varDecl->container == VarDecl::Container::Deque) {
+        usesDeques = true;
+        dequeLists.insert(varDecl->name);
+        output << "collections.deque(";
+        generateExpression(varDecl->initializer);
+        output << ")";
+    } else if (varDecl->initializer) {
         generateExpression(varDecl->initializer);
     } else {
         output << "None";
@@ -115,6 +218,9 @@ void PythonCodeGen::generateVarDecl(const std::shared_ptr<VarDecl>& varDecl) {
 
 // function definition
 void PythonCodeGen::generateFunction(const std::shared_ptr<Function>& func) {
+    if (func->memoize) {
+        output << currentIndent << "@functools.lru_cache(maxsize=None)\n";
+    }
     output << currentIndent << "def " << func->name << "(";
 
     // parameters
@@ -163,6 +269,7 @@ void PythonCodeGen::generateFunction(const std::shared_ptr<Function>& func) {
             generateStatement(stmt);
         }
         inFunction = false;
+        dequeLists.clear();
     }
     dedent();
     output << "\n";
@@ -257,6 +364,11 @@ void PythonCodeGen::collectAssignedVariables(const ExprPtr& expr, std::set<std::
 
 // assignment statement
 void PythonCodeGen::generateAssignment(const std::shared_ptr<Assignment>& assign) {
+    auto target = std::dynamic_pointer_cast<Identifier>(assign->target);
+    if (assign->appendInPlace && target && stringBuilders.count(target->name)) {
+        generateBuilderAppend(assign);
+        return;
+    }
     output << currentIndent;
     generateExpression(assign->target);
     output << " = ";
@@ -264,6 +376,46 @@ void PythonCodeGen::generateAssignment(const std::shared_ptr<Assignment>& assign
     output << "\n";
 }
 
+// s = s + a + b  becomes  _hl_s_parts.extend((a, b)), likewise for
+// s = s.concat(a)
+void PythonCodeGen::generateBuilderAppend(const std::shared_ptr<Assignment>& assign) {
+    std::vector<ExprPtr> parts;
+    ExprPtr node = assign->value;
+    while (!std::dynamic_pointer_cast<Identifier>(node)) {
+        if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(node)) {
+            parts.insert(parts.begin(), binaryOp->right);
+            node = binaryOp->left;
+        } else {
+            auto call = std::dynamic_pointer_cast<FunctionCall>(node);
+            parts.insert(parts.begin(), call->arguments[0]);
+            node = std::dynamic_pointer_cast<MemberAccess>(call->callee)->object;
+        }
+    }
+    output << currentIndent << "_hl_" << std::dynamic_pointer_cast<Identifier>(node)->name << "_parts.";
+    output << (parts.size() == 1 ? "append(" : "extend((");
+    for (size_t i = 0; i < parts.size(); ++i) {
+        generateExpression(parts[i]);
+        if (i < parts.size() - 1) {
+            output << ", ";
+        }
+    }
+    output << (parts.size() == 1 ? ")\n" : "))\n");
+}
+
+void PythonCodeGen::openStringBuilders(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+        output << currentIndent << "_hl_" << name << "_parts = [" << name << "]\n";
+        stringBuilders.insert(name);
+    }
+}
+
+void PythonCodeGen::closeStringBuilders(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+        output << currentIndent << name << " = \"\".join(_hl_" << name << "_parts)\n";
+        stringBuilders.erase(name);
+    }
+}
+
 // expression
 void PythonCodeGen::generateExpression(const ExprPtr& expr) {
     if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
@@ -281,6 +433,11 @@ void PythonCodeGen::generateExpression(const ExprPtr& expr) {
         }
         // list literals
         else if (std::holds_alternative<std::vector<ExprPtr>>(literal->value)) {
+            bool matrix = literal->type && literal->type->kind == Type::Kind::MATRIX;
+            if (matrix) {
+                usesNumpy = true;
+                output << "np.array(";
+            }
             output << "[";
             const auto& elements = std::get<std::vector<ExprPtr>>(literal->value);
             for (size_t i = 0; i < elements.size(); ++i) {
@@ -290,6 +447,9 @@ void PythonCodeGen::generateExpression(const ExprPtr& expr) {
                 }
             }
             output << "]";
+            if (matrix) {
+                output << ", dtype=" << convertType(literal->type->elementType) << ")";
+            }
         }
     }
     else if (auto identifier = std::dynamic_pointer_cast<Identifier>(expr)) {
@@ -368,6 +528,8 @@ std::string PythonCodeGen::binaryOperatorToString(BinaryOp::Operator op) {
         case BinaryOp::Operator::GE:  return ">=";
         case BinaryOp::Operator::AND: return "and";
         case BinaryOp::Operator::OR:  return "or";
+        case BinaryOp::Operator::SHR: return ">>";
+        case BinaryOp::Operator::BITAND: return "&";
         default: return "?";
     }
 }
@@ -464,6 +626,32 @@ void PythonCodeGen::generateFunctionCall(const std::shared_ptr<FunctionCall>& ca
             generateExpression(call->arguments[0]);
             output << ")";
         }
+        else if (methodName == "sum" || methodName == "min" || methodName == "max") {
+            // Python's builtins
+            output << methodName << "(";
+            generateExpression(memberAccess->object);
+            output << ")";
+        }
+        else if (methodName == "rows" || methodName == "cols") {
+            generateExpression(memberAccess->object);
+            output << ".shape[" << (methodName == "rows" ? 0 : 1) << "]";
+        }
+        else if (methodName == "matmul") {
+            output << "(";
+            generateExpression(memberAccess->object);
+            output << " @ ";
+            generateExpression(call->arguments[0]);
+            output << ")";
+        }
+        else if (methodName == "dot" || methodName == "scale" || methodName == "add") {
+            // _hl_dot(xs, ys) etc., defined at the top of the program
+            usesListKernels = true;
+            output << "_hl_" << methodName << "(";
+            generateExpression(memberAccess->object);
+            output << ", ";
+            generateExpression(call->arguments[0]);
+            output << ")";
+        }
         else {
 
             auto it = builtinFunctions.find(methodName);
@@ -482,6 +670,16 @@ void PythonCodeGen::generateFunctionCall(const std::shared_ptr<FunctionCall>& ca
                     generateExpression(call->arguments[0]);
                     output << ")";
                 }
+                else if (methodName == "remove" && std::dynamic_pointer_cast<Identifier>(memberAccess->object) &&
+                         dequeLists.count(std::dynamic_pointer_cast<Identifier>(memberAccess->object)->name)) {
+                    // del obj[arg0]; a deque's pop() takes no index, and
+                    // del at either end is constant time
+                    output << "del ";
+                    generateExpression(memberAccess->object);
+                    output << "[";
+                    generateExpression(call->arguments[0]);
+                    output << "]";
+                }
                 else if (methodName == "remove") {
                     // obj.pop(arg0)
                     generateExpression(memberAccess->object);
@@ -527,7 +725,20 @@ void PythonCodeGen::generateFunctionCall(const std::shared_ptr<FunctionCall>& ca
         std::string functionName = identifier->name;
 
         auto it = builtinFunctions.find(functionName);
-        if (it != builtinFunctions.end()) {
+        if (functionName == "zeros") {
+            // np.zeros((rows, cols), dtype=float), typed by the matrix it initializes
+            usesNumpy = true;
+            output << "np.zeros((";
+            generateExpression(call->arguments[0]);
+            output << ", ";
+            generateExpression(call->arguments[1]);
+            output << "), dtype=" << convertType(call->type->elementType) << ")";
+        }
+        else if (it != builtinFunctions.end()) {
+            if (functionName == "input" || functionName == "flush" || functionName == "readInts" ||
+                functionName == "readLines") {
+                usesIO = true;
+            }
             output << it->second << "(";
             for (size_t i = 0; i < call->arguments.size(); ++i) {
                 generateExpression(call->arguments[i]);
@@ -565,6 +776,17 @@ void PythonCodeGen::generateFunctionCall(const std::shared_ptr<FunctionCall>& ca
 
 // list access
 void PythonCodeGen::generateListAccess(const std::shared_ptr<ListAccess>& listAccess) {
+    // m[i][j] on a matrix indexes the array once, as m[i, j]
+    auto row = std::dynamic_pointer_cast<ListAccess>(listAccess->list);
+    if (row && row->type && row->type->kind == Type::Kind::MATRIX) {
+        generateExpression(row->list);
+        output << "[";
+        generateExpression(row->index);
+        output << ", ";
+        generateExpression(listAccess->index);
+        output << "]";
+        return;
+    }
     generateExpression(listAccess->list);
     output << "[";
     generateExpression(listAccess->index);
@@ -580,20 +802,16 @@ void PythonCodeGen::generateMemberAccess(const std::shared_ptr<MemberAccess>& me
 // try-catch block
 void PythonCodeGen::generateTryCatch(const std::shared_ptr<TryCatch>& tryCatch) {
     output << currentIndent << "try:\n";
-    indent();
-    for (const auto& stmt : tryCatch->tryBlock) {
-        generateStatement(stmt);
-    }
-    dedent();
+    generateBlock(tryCatch->tryBlock);
     output << currentIndent << "except Exception as " << tryCatch->exceptionName << ":\n";
-    indent();
-    for (const auto& stmt : tryCatch->catchBlock) {
-        generateStatement(stmt);
-    }
-    dedent();
+    generateBlock(tryCatch->catchBlock);
 }
 
 void PythonCodeGen::generateForLoop(const std::shared_ptr<For>& forLoop) {
+    // A `parallel for` runs sequentially here: threads would hold the GIL
+    // and worker processes could not write the shared lists its iterations
+    // fill, so neither would be faster. Reductions are plain updates
+    openStringBuilders(forLoop->builtStrings);
     output << currentIndent << "for " << forLoop->iterator << " in range(";
 
     // start and end expressions
@@ -646,8 +864,17 @@ void PythonCodeGen::generateForLoop(const std::shared_ptr<For>& forLoop) {
 
     output << "):\n";
 
+    generateBlock(forLoop->body);
+    closeStringBuilders(forLoop->builtStrings);
+}
+
+// indented block, `pass` keeps empty blocks valid
+void PythonCodeGen::generateBlock(const std::vector<StmtPtr>& block) {
     indent();
-    for (const auto& stmt : forLoop->body) {
+    if (block.empty()) {
+        output << currentIndent << "pass\n";
+    }
+    for (const auto& stmt : block) {
         generateStatement(stmt);
     }
     dedent();
@@ -655,46 +882,32 @@ void PythonCodeGen::generateForLoop(const std::shared_ptr<For>& forLoop) {
 
 // Generate while loop
 void PythonCodeGen::generateWhileLoop(const std::shared_ptr<While>& whileLoop) {
+    openStringBuilders(whileLoop->builtStrings);
     output << currentIndent << "while ";
     generateExpression(whileLoop->condition);
     output << ":\n";
-    indent();
-    for (const auto& stmt : whileLoop->body) {
-        generateStatement(stmt);
-    }
-    dedent();
+    generateBlock(whileLoop->body);
+    closeStringBuilders(whileLoop->builtStrings);
 }
 
 void PythonCodeGen::generateIfStatement(const std::shared_ptr<If>& ifStmt) {
     output << currentIndent << "if ";
     generateExpression(ifStmt->condition);
     output << ":\n";
-    indent();
-    for (const auto& stmt : ifStmt->thenBlock) {
-        generateStatement(stmt);
-    }
-    dedent();
+    generateBlock(ifStmt->thenBlock);
 
     // Handle elif blocks
     for (const auto& elifPair : ifStmt->elifBlocks) {
         output << currentIndent << "elif ";
         generateExpression(elifPair.first);  // elif condition
         output << ":\n";
-        indent();
-        for (const auto& stmt : elifPair.second) {  // elif body
-            generateStatement(stmt);
-        }
-        dedent();
+        generateBlock(elifPair.second);
     }
 
     // Handle else block
     if (!ifStmt->elseBlock.empty()) {
         output << currentIndent << "else:\n";
-        indent();
-        for (const auto& stmt : ifStmt->elseBlock) {
-            generateStatement(stmt);
-        }
-        dedent();
+        generateBlock(ifStmt->elseBlock);
     }
 }
 
@@ -708,7 +921,8 @@ void PythonCodeGen::generateReturnStatement(const std::shared_ptr<Return>& retur
 }
 
 void PythonCodeGen::generatePrint(const std::shared_ptr<Print>& printStmt) {
-    output << currentIndent << "print(";
+    usesIO = true;
+    output << currentIndent << "_hl_print(";
     generateExpression(printStmt->expression);
     output << ")\n";
 }
@@ -744,6 +958,9 @@ std::string PythonCodeGen::convertType(const TypePtr& type) {
             else {
                 return "List[Any]";
             }
+        case Type::Kind::MATRIX:
+            usesNumpy = true;
+            return "np.ndarray";
         case Type::Kind::VOID:
             return "None";
         default:
@@ -28,6 +28,7 @@ private:
     // Code generation methods
     void generateExpression(const ExprPtr& expr);
     void generateStatement(const StmtPtr& stmt);
+    void generateBlock(const std::vector<StmtPtr>& block);
     void generateFunction(const std::shared_ptr<Function>& func);
     void generateVarDecl(const std::shared_ptr<VarDecl>& varDecl);
     void generateAssignment(const std::shared_ptr<Assignment>& assign);
@@ -62,6 +63,28 @@ private:
     // Flag to indicate if we are inside a function
     bool inFunction = false;
 
+    // Strings being built as a list of parts by an enclosing loop
+    std::unordered_set<std::string> stringBuilders;
+    void openStringBuilders(const std::vector<std::string>& names);
+    void closeStringBuilders(const std::vector<std::string>& names);
+    void generateBuilderAppend(const std::shared_ptr<Assignment>& assign);
+
+    // Locals of the current function the optimizer stored in a
+    // collections.deque, whose remove() is a `del` rather than a pop(i)
+    std::unordered_set<std::string> dequeLists;
+    bool usesDeques = false;
+
+    // Set when the program calls `dot`, `scale` or `add` on a list, so the
+    // helpers in listKernels are emitted
+    bool usesListKernels = false;
+    static const std::string listKernels;
+    // Matrices are NumPy arrays; set when the program has any
+    bool usesNumpy = false;
+    // Set when the program prints, reads input or flushes, so the buffered
+    // I/O helpers in ioHelpers are emitted
+    bool usesIO = false;
+    static const std::string ioHelpers;
+
 public:
     PythonCodeGen() = default;
 
@@ -18,6 +18,7 @@ std::unordered_map<std::string, TokenType> Lexer::keywords = {
     {"bool", TokenType::BOOL},
     {"void", TokenType::VOID},
     {"list", TokenType::LIST},
+    {"matrix", TokenType::MATRIX},
     {"and", TokenType::AND},
     {"or", TokenType::OR},
     {"not", TokenType::NOT},
@@ -64,6 +65,7 @@ std::vector<Token> Lexer::tokenize() {
             case '[': tokens.push_back(makeToken(TokenType::LBRACKET)); break;
             case ']': tokens.push_back(makeToken(TokenType::RBRACKET)); break;
             case ',': tokens.push_back(makeToken(TokenType::COMMA)); break;
+            case ':': tokens.push_back(makeToken(TokenType::COLON)); break;
             case '.': tokens.push_back(makeToken(TokenType::DOT)); break;
             case ';': tokens.push_back(makeToken(TokenType::SEMICOLON)); break;
             case '+': tokens.push_back(makeToken(TokenType::PLUS)); break;
@@ -26,6 +26,7 @@ enum class TokenType {
     STRING,
     BOOL,
     LIST,
+    MATRIX,
     VOID,
 
     // Literals
@@ -63,6 +64,7 @@ enum class TokenType {
     LBRACKET,       // [
     RBRACKET,       // ]
     COMMA,          // ,
+    COLON,          // :
     SEMICOLON,      // ;
     DOT,            // .
 
@@ -22,6 +22,7 @@ std::string tokenTypeToString(TokenType type) {
         case TokenType::STRING: return "STRING";
         case TokenType::BOOL: return "BOOL";
         case TokenType::LIST: return "LIST";
+        case TokenType::MATRIX: return "MATRIX";
         case TokenType::VOID: return "VOID";
         case TokenType::INTEGER_LITERAL: return "INTEGER_LITERAL";
         case TokenType::FLOAT_LITERAL: return "FLOAT_LITERAL";
@@ -49,6 +50,7 @@ std::string tokenTypeToString(TokenType type) {
         case TokenType::LBRACKET: return "LBRACKET";
         case TokenType::RBRACKET: return "RBRACKET";
         case TokenType::COMMA: return "COMMA";
+        case TokenType::COLON: return "COLON";
         case TokenType::SEMICOLON: return "SEMICOLON";
         case TokenType::DOT: return "DOT";
         case TokenType::IDENTIFIER: return "IDENTIFIER";
@@ -11,7 +11,9 @@
 #include "ast/ASTprint.h"
 #include "codegen/Python/PythonCodegen.h"
 #include "codegen/CPP/CppCodeGen.h"
+#include "codegen/CPP/CppBuilder.h"
 #include "semantic/SemanticAnalyzer.h"
+#include "optimizer/Optimizer.h"
 
 enum class CompilerChoice {
     Python,
@@ -51,18 +53,36 @@ bool compilePython(const std::string& filename) {
     return result == 0;
 }
 
-bool compileCpp(const std::string& filename) {
+bool compileCpp(const std::string& filename, const CppBuildOptions& buildOptions, bool runProgram) {
     std::cout << "\nCompiling C++ code...\n";
 
-    // compilation command using CMake
-    std::string buildCmd = "cmake --build . --target output_executable";
-    if (system(buildCmd.c_str()) != 0) {
-        std::cerr << "Failed to build C++ code using CMake\n";
-        return false;
+    CppBuilder builder(buildOptions);
+    bool built = builder.build(filename);
+    if (builder.wasCached()) {
+        std::cout << "Build: reused cached binary, nothing to compile\n";
+    } else {
+        if (builder.getRuntimeSeconds() > 0) {
+            std::cout << "Prepared precompiled runtime in " << static_cast<int>(builder.getRuntimeSeconds() * 1000)
+                      << " ms\n";
+        }
+        if (!buildOptions.trainingInput.empty()) {
+            std::cout << (builder.wasTrained() ? "PGO: trained on " + buildOptions.trainingInput
+                                               : "PGO: reused profile")
+                      << ", profile in " << buildOptions.profileDir << "\n";
+        }
+        std::cout << "Build: " << builder.getCommand() << "\n";
+        if (!built) {
+            std::cerr << "Failed to build C++ code\n";
+            return false;
+        }
+        std::cout << "Built in " << static_cast<int>(builder.getBuildSeconds() * 1000) << " ms\n";
     }
 
+    if (!runProgram) {
+        return true;
+    }
     std::cout << "Running C++ executable...\n";
-    int result = system("./output_executable");
+    int result = system(builder.getExecutable().c_str());
     return result == 0;
 }
 
@@ -86,18 +106,120 @@ bool isHlFile(const std::string& filename) {
 
 int main(int argc, char* argv[]) {
     std::string testInput;
+    std::string inputFile;
+    OptimizerOptions optimizerOptions;
+    CppBuildOptions buildOptions;
+    CompilerChoice targetChoice = CompilerChoice::Invalid;
+    bool runProgram = true;
+    AllocMode allocMode = AllocMode::System;
+    bool allocStats = false;
 
-    if (argc > 1) {
-        if (!isHlFile(argv[1])) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-optimize") {
+            optimizerOptions.enabled = false;
+        } else if (arg == "--no-dce") {
+            optimizerOptions.eliminateDeadCode = false;
+        } else if (arg == "--no-strength-reduce") {
+            optimizerOptions.reduceStrength = false;
+        } else if (arg == "--no-licm") {
+            optimizerOptions.hoistLoopInvariants = false;
+        } else if (arg == "--no-cse") {
+            optimizerOptions.eliminateCommonSubexpressions = false;
+        } else if (arg == "--auto-parallel") {
+            optimizerOptions.autoParallelize = true;
+        } else if (arg.rfind("--parallel-threshold=", 0) == 0) {
+            try {
+                optimizerOptions.parallelThreshold =
+                    std::stoll(arg.substr(std::string("--parallel-threshold=").size()));
+            } catch (const std::exception&) {
+                std::cerr << "Error: Invalid value for '--parallel-threshold'." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--no-const-ref") {
+            optimizerOptions.constRefParams = false;
+        } else if (arg == "--no-move") {
+            optimizerOptions.eliminateCopies = false;
+        } else if (arg == "--no-string-builder") {
+            optimizerOptions.buildStrings = false;
+        } else if (arg == "--no-containers") {
+            optimizerOptions.selectContainers = false;
+        } else if (arg == "--no-tco") {
+            optimizerOptions.eliminateTailCalls = false;
+        } else if (arg == "--memoize") {
+            optimizerOptions.memoizeAll = true;
+        } else if (arg == "--no-memoize") {
+            optimizerOptions.memoizeRecursive = false;
+        } else if (arg == "--no-inline") {
+            optimizerOptions.inlineFunctions = false;
+        } else if (arg.rfind("--inline-threshold=", 0) == 0) {
+            try {
+                optimizerOptions.inlineThreshold = std::stoi(arg.substr(std::string("--inline-threshold=").size()));
+            } catch (const std::exception&) {
+                std::cerr << "Error: Invalid value for '--inline-threshold'." << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            if (!CppBuilder::parseProfile(arg.substr(std::string("--profile=").size()), buildOptions.profile)) {
+                std::cerr << "Error: Invalid value for '--profile' (expected fast, optimized or release)." << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--cxx=", 0) == 0) {
+            buildOptions.compiler = arg.substr(std::string("--cxx=").size());
+        } else if (arg.rfind("--cxxflags=", 0) == 0) {
+            buildOptions.extraFlags = arg.substr(std::string("--cxxflags=").size());
+        } else if (arg.rfind("--output=", 0) == 0) {
+            buildOptions.outputPath = arg.substr(std::string("--output=").size());
+        } else if (arg.rfind("--runtime-dir=", 0) == 0) {
+            buildOptions.runtimeDir = arg.substr(std::string("--runtime-dir=").size());
+        } else if (arg == "--target=python") {
+            targetChoice = CompilerChoice::Python;
+        } else if (arg == "--target=cpp") {
+            targetChoice = CompilerChoice::Cpp;
+        } else if (arg == "--alloc=arena") {
+            allocMode = AllocMode::Arena;
+        } else if (arg == "--alloc=system") {
+            allocMode = AllocMode::System;
+        } else if (arg == "--alloc-stats") {
+            allocStats = true;
+        } else if (arg == "--no-run") {
+            runProgram = false;
+        } else if (arg.rfind("--pgo=", 0) == 0) {
+            buildOptions.trainingInput = arg.substr(std::string("--pgo=").size());
+        } else if (arg == "--no-pch") {
+            buildOptions.usePrebuiltRuntime = false;
+        } else if (arg == "--no-cache") {
+            buildOptions.useCache = false;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            buildOptions.cacheDir = arg.substr(std::string("--cache-dir=").size());
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            try {
+                buildOptions.cacheSizeLimit = std::stoull(arg.substr(std::string("--cache-size=").size())) * 1024 * 1024;
+            } catch (const std::exception&) {
+                std::cerr << "Error: Invalid value for '--cache-size'." << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option '" << arg << "'." << std::endl;
+            return 1;
+        } else {
+            inputFile = arg;
+        }
+    }
+
+    if (!inputFile.empty()) {
+        if (!isHlFile(inputFile)) {
             std::cerr << "Error: Only '.hl' files are allowed as input." << std::endl;
             return 1;
         }
         try {
-            testInput = loadFileContent(argv[1]);
+            testInput = loadFileContent(inputFile);
         } catch (const std::exception& e) {
             std::cerr << "Error: " << e.what() << std::endl;
             return 1;
         }
+        // Training profiles are kept next to the program they were recorded for
+        buildOptions.profileDir = inputFile.substr(0, inputFile.size() - 3) + ".profile";
     } else {
         std::cout << "No input file provided. Enter your code line by line (type END to finish):\n";
 
@@ -141,29 +263,37 @@ int main(int argc, char* argv[]) {
 
         std::cout << "\nParsing and Semantic analysis successful!\n" << std::endl;
 
+        // Get user's compiler choice, unless given with --target. Some
+        // rewrites depend on it, so it is known before optimizing
+        CompilerChoice choice = targetChoice != CompilerChoice::Invalid ? targetChoice : getCompilerChoice();
+        optimizerOptions.targetsCpp = choice == CompilerChoice::Cpp;
+
+        Optimizer optimizer(optimizerOptions);
+        optimizer.optimize(program);
+        for (const auto& note : optimizer.getDiagnostics()) {
+            std::cout << "Optimizer: " << note << std::endl;
+        }
+
         // Uncomment lines below to see AST Structure
         // std::cout << "\nAST structure:" << std::endl;
         // ASTPrinter::printAST(program);
 
-        // Get user's compiler choice
-        CompilerChoice choice = getCompilerChoice();
-
         try {
             if (choice == CompilerChoice::Python) {
                 PythonCodeGen pycodegen;
                 std::string pythonCode = pycodegen.generate(program);
                 std::string outputFile = "output.py";
                 pycodegen.writeToFile(outputFile, pythonCode);
-                if (!compilePython(outputFile)) {
+                if (runProgram && !compilePython(outputFile)) {
                     std::cerr << "Python compilation/execution failed\n";
                     return 1;
                 }
             } else {
-                CppCodeGen cppcodegen;
+                CppCodeGen cppcodegen(allocMode, allocStats);
                 std::string cppCode = cppcodegen.generate(program);
                 std::string outputFile = "output.cpp";
                 cppcodegen.writeToFile(outputFile, cppCode);
-                if (!compileCpp(outputFile)) {
+                if (!compileCpp(outputFile, buildOptions, runProgram)) {
                     std::cerr << "C++ compilation/execution failed\n";
                     return 1;
                 }
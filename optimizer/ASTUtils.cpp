@@ -0,0 +1,381 @@
+#include "ASTUtils.h"
+#include <typeinfo>
+
+namespace ASTUtils {
+    void forEachSubExpression(const ExprPtr& expr, const std::function<void(ExprPtr&)>& fn) {
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            if (std::holds_alternative<std::vector<ExprPtr>>(literal->value)) {
+                for (auto& element : std::get<std::vector<ExprPtr>>(literal->value)) {
+                    fn(element);
+                }
+            }
+        } else if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+            fn(binaryOp->left);
+            fn(binaryOp->right);
+        } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+            fn(unaryOp->operand);
+        } else if (auto funcCall = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            if (auto memberAccess = std::dynamic_pointer_cast<MemberAccess>(funcCall->callee)) {
+                fn(memberAccess->object);
+            }
+            for (auto& arg : funcCall->arguments) {
+                fn(arg);
+            }
+        } else if (auto memberAccess = std::dynamic_pointer_cast<MemberAccess>(expr)) {
+            fn(memberAccess->object);
+        } else if (auto listAccess = std::dynamic_pointer_cast<ListAccess>(expr)) {
+            fn(listAccess->list);
+            fn(listAccess->index);
+        } else if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+            fn(assignment->target);
+            fn(assignment->value);
+        }
+    }
+
+    void forEachStatementExpression(const StmtPtr& stmt, const std::function<void(ExprPtr&)>& fn) {
+        if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
+            fn(exprStmt->expression);
+        } else if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            if (varDecl->initializer) fn(varDecl->initializer);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            fn(ifStmt->condition);
+            for (auto& elif : ifStmt->elifBlocks) {
+                fn(elif.first);
+            }
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            fn(whileStmt->condition);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            fn(forStmt->start);
+            fn(forStmt->end);
+            if (forStmt->step) fn(forStmt->step);
+        } else if (auto returnStmt = std::dynamic_pointer_cast<Return>(stmt)) {
+            if (returnStmt->value) fn(returnStmt->value);
+        } else if (auto printStmt = std::dynamic_pointer_cast<Print>(stmt)) {
+            fn(printStmt->expression);
+        } else if (auto inputStmt = std::dynamic_pointer_cast<Input>(stmt)) {
+            fn(inputStmt->prompt);
+        }
+    }
+
+    void forEachBlock(const StmtPtr& stmt, const std::function<void(std::vector<StmtPtr>&)>& fn) {
+        if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            fn(ifStmt->thenBlock);
+            for (auto& elif : ifStmt->elifBlocks) {
+                fn(elif.second);
+            }
+            fn(ifStmt->elseBlock);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            fn(whileStmt->body);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            fn(forStmt->body);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            fn(tryCatch->tryBlock);
+            fn(tryCatch->catchBlock);
+        } else if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            fn(func->body);
+        }
+    }
+
+    std::string calledFunctionName(const ExprPtr& expr) {
+        if (auto funcCall = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            if (auto ident = std::dynamic_pointer_cast<Identifier>(funcCall->callee)) {
+                if (!isBuiltinFunction(ident->name)) {
+                    return ident->name;
+                }
+            }
+        }
+        return "";
+    }
+
+    bool isBuiltinFunction(const std::string& name) {
+        return isIOBuiltin(name) || name == "STR" || name == "INT" || name == "FLOAT" || name == "zeros";
+    }
+
+    bool isIOBuiltin(const std::string& name) {
+        return name == "input" || name == "flush" || name == "readInts" || name == "readLines";
+    }
+
+    bool isMutatingListMethod(const std::string& name) {
+        return name == "append" || name == "prepend" || name == "remove" || name == "empty";
+    }
+
+    bool hasSideEffects(const ExprPtr& expr) {
+        if (!expr) return false;
+        if (std::dynamic_pointer_cast<Assignment>(expr)) {
+            return true;
+        }
+        if (auto funcCall = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            if (auto ident = std::dynamic_pointer_cast<Identifier>(funcCall->callee)) {
+                if (isIOBuiltin(ident->name) || !isBuiltinFunction(ident->name)) {
+                    return true;
+                }
+            } else if (auto memberAccess = std::dynamic_pointer_cast<MemberAccess>(funcCall->callee)) {
+                if (isMutatingListMethod(memberAccess->memberName)) {
+                    return true;
+                }
+            } else {
+                return true;
+            }
+        }
+        bool result = false;
+        forEachSubExpression(expr, [&](ExprPtr& sub) {
+            if (!result && hasSideEffects(sub)) result = true;
+        });
+        return result;
+    }
+
+    static bool isNonZeroLiteral(const ExprPtr& expr) {
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            if (std::holds_alternative<int>(literal->value)) return std::get<int>(literal->value) != 0;
+            if (std::holds_alternative<float>(literal->value)) return std::get<float>(literal->value) != 0.0f;
+        }
+        return false;
+    }
+
+    bool mayTrap(const ExprPtr& expr) {
+        if (!expr) return false;
+        if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+            if ((binaryOp->op == BinaryOp::Operator::DIV || binaryOp->op == BinaryOp::Operator::MOD) &&
+                !binaryOp->nonZeroDivisor && !isNonZeroLiteral(binaryOp->right)) {
+                return true;
+            }
+        } else if (std::dynamic_pointer_cast<ListAccess>(expr)) {
+            return true;
+        } else if (auto funcCall = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            if (auto ident = std::dynamic_pointer_cast<Identifier>(funcCall->callee)) {
+                if (ident->name == "INT" || ident->name == "FLOAT" || ident->name == "zeros" ||
+                    ident->name == "readInts") {
+                    return true;
+                }
+            } else if (auto memberAccess = std::dynamic_pointer_cast<MemberAccess>(funcCall->callee)) {
+                // min/max of an empty list, dot/add/matmul of mismatched sizes
+                const std::string& name = memberAccess->memberName;
+                if (name == "substring" || name == "toBinary" || name == "min" || name == "max" || name == "dot" ||
+                    name == "add" || name == "matmul") {
+                    return true;
+                }
+            }
+        }
+        bool result = false;
+        forEachSubExpression(expr, [&](ExprPtr& sub) {
+            if (!result && mayTrap(sub)) result = true;
+        });
+        return result;
+    }
+
+    void collectReads(const ExprPtr& expr, std::unordered_set<std::string>& names) {
+        if (!expr) return;
+        if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+            names.insert(ident->name);
+            return;
+        }
+        if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+            // A plain `x = ...` does not read x
+            if (!std::dynamic_pointer_cast<Identifier>(assignment->target)) {
+                collectReads(assignment->target, names);
+            }
+            collectReads(assignment->value, names);
+            return;
+        }
+        forEachSubExpression(expr, [&](ExprPtr& sub) { collectReads(sub, names); });
+    }
+
+    void collectWrittenVariables(const ExprPtr& expr, std::unordered_set<std::string>& names) {
+        if (!expr) return;
+        if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+            names.insert(rootVariable(assignment->target));
+        } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+            if (member && isMutatingListMethod(member->memberName)) {
+                names.insert(rootVariable(member->object));
+            }
+        }
+        forEachSubExpression(expr, [&](ExprPtr& sub) { collectWrittenVariables(sub, names); });
+    }
+
+    std::vector<ExprPtr> stringAppendParts(const std::shared_ptr<Assignment>& assignment) {
+        auto target = std::dynamic_pointer_cast<Identifier>(assignment->target);
+        if (!target) return {};
+
+        std::vector<ExprPtr> parts;
+        ExprPtr node = assignment->value;
+        while (true) {
+            ExprPtr part;
+            if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(node)) {
+                if (binaryOp->op != BinaryOp::Operator::ADD || !binaryOp->type ||
+                    binaryOp->type->kind != Type::Kind::STRING) {
+                    break;
+                }
+                part = binaryOp->right;
+                node = binaryOp->left;
+            } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(node)) {
+                auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+                if (!member || member->memberName != "concat" || call->arguments.size() != 1) break;
+                part = call->arguments[0];
+                node = member->object;
+            } else {
+                break;
+            }
+            std::unordered_set<std::string> reads;
+            collectReads(part, reads);
+            if (!part->type || part->type->kind != Type::Kind::STRING || reads.count(target->name)) {
+                return {};
+            }
+            parts.insert(parts.begin(), part);
+        }
+        auto base = std::dynamic_pointer_cast<Identifier>(node);
+        // Assignment targets carry no type, the read of s on the right does
+        if (!base || base->name != target->name || !base->type || base->type->kind != Type::Kind::STRING) {
+            return {};
+        }
+        return parts;
+    }
+
+    std::string rootVariable(const ExprPtr& expr) {
+        if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+            return ident->name;
+        }
+        if (auto listAccess = std::dynamic_pointer_cast<ListAccess>(expr)) {
+            return rootVariable(listAccess->list);
+        }
+        return "";
+    }
+
+    std::string typeName(const TypePtr& type) {
+        if (!type) return "?";
+        switch (type->kind) {
+            case Type::Kind::INT: return "int";
+            case Type::Kind::FLOAT: return "float";
+            case Type::Kind::STRING: return "string";
+            case Type::Kind::BOOL: return "bool";
+            case Type::Kind::LIST: return "list<" + typeName(type->elementType) + ">";
+            case Type::Kind::MATRIX: return "matrix<" + typeName(type->elementType) + ">";
+            case Type::Kind::VOID: return "void";
+            case Type::Kind::MATHOBJECT: return "Math";
+        }
+        return "?";
+    }
+
+    ExprPtr cloneExpression(const ExprPtr& expr) {
+        if (!expr) return nullptr;
+        ExprPtr copy;
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            if (std::holds_alternative<std::vector<ExprPtr>>(literal->value)) {
+                std::vector<ExprPtr> elements;
+                for (const auto& element : std::get<std::vector<ExprPtr>>(literal->value)) {
+                    elements.push_back(cloneExpression(element));
+                }
+                copy = std::make_shared<Literal>(std::move(elements));
+            } else {
+                auto literalCopy = std::make_shared<Literal>(0);
+                literalCopy->value = literal->value;
+                copy = literalCopy;
+            }
+        } else if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+            copy = std::make_shared<Identifier>(ident->name);
+        } else if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+            auto binaryCopy = std::make_shared<BinaryOp>(binaryOp->op, cloneExpression(binaryOp->left),
+                                                         cloneExpression(binaryOp->right));
+            binaryCopy->nonZeroDivisor = binaryOp->nonZeroDivisor;
+            copy = binaryCopy;
+        } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+            copy = std::make_shared<UnaryOp>(unaryOp->op, cloneExpression(unaryOp->operand));
+        } else if (auto funcCall = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            std::vector<ExprPtr> args;
+            for (const auto& arg : funcCall->arguments) {
+                args.push_back(cloneExpression(arg));
+            }
+            copy = std::make_shared<FunctionCall>(cloneExpression(funcCall->callee), std::move(args),
+                                                  funcCall->isBuiltIn);
+        } else if (auto memberAccess = std::dynamic_pointer_cast<MemberAccess>(expr)) {
+            copy = std::make_shared<MemberAccess>(cloneExpression(memberAccess->object), memberAccess->memberName);
+        } else if (auto listAccess = std::dynamic_pointer_cast<ListAccess>(expr)) {
+            copy = std::make_shared<ListAccess>(cloneExpression(listAccess->list), cloneExpression(listAccess->index));
+        } else if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+            auto assignCopy = std::make_shared<Assignment>(cloneExpression(assignment->target),
+                                                           cloneExpression(assignment->value));
+            assignCopy->Expression::type = assignment->Expression::type;
+            return assignCopy;
+        } else {
+            return expr;
+        }
+        copy->type = expr->type;
+        copy->line = expr->line;
+        copy->column = expr->column;
+        return copy;
+    }
+
+    int expressionSize(const ExprPtr& expr) {
+        if (!expr) return 0;
+        int size = 1;
+        forEachSubExpression(expr, [&](ExprPtr& sub) { size += expressionSize(sub); });
+        return size;
+    }
+
+    static size_t combineHash(size_t seed, size_t value) {
+        return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    }
+
+    size_t hashExpression(const ExprPtr& expr) {
+        if (!expr) return 0;
+        size_t hash = std::hash<std::string>()(typeid(*expr).name());
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            hash = combineHash(hash, literal->value.index());
+            if (auto value = std::get_if<int>(&literal->value)) hash = combineHash(hash, std::hash<int>()(*value));
+            if (auto value = std::get_if<float>(&literal->value)) hash = combineHash(hash, std::hash<float>()(*value));
+            if (auto value = std::get_if<bool>(&literal->value)) hash = combineHash(hash, std::hash<bool>()(*value));
+            if (auto value = std::get_if<std::string>(&literal->value)) {
+                hash = combineHash(hash, std::hash<std::string>()(*value));
+            }
+        } else if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+            hash = combineHash(hash, std::hash<std::string>()(ident->name));
+        } else if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+            hash = combineHash(hash, static_cast<size_t>(binaryOp->op));
+        } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+            hash = combineHash(hash, static_cast<size_t>(unaryOp->op));
+        } else if (auto memberAccess = std::dynamic_pointer_cast<MemberAccess>(expr)) {
+            hash = combineHash(hash, std::hash<std::string>()(memberAccess->memberName));
+        } else if (auto funcCall = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            hash = combineHash(hash, hashExpression(funcCall->callee));
+        }
+        forEachSubExpression(expr, [&](ExprPtr& sub) { hash = combineHash(hash, hashExpression(sub)); });
+        return hash;
+    }
+
+    bool equalExpressions(const ExprPtr& a, const ExprPtr& b) {
+        if (a == b) return true;
+        if (!a || !b || typeid(*a) != typeid(*b)) return false;
+
+        if (auto literalA = std::dynamic_pointer_cast<Literal>(a)) {
+            auto literalB = std::static_pointer_cast<Literal>(b);
+            if (literalA->value.index() != literalB->value.index()) return false;
+            if (!std::holds_alternative<std::vector<ExprPtr>>(literalA->value)) {
+                return literalA->value == literalB->value;
+            }
+        } else if (auto identA = std::dynamic_pointer_cast<Identifier>(a)) {
+            return identA->name == std::static_pointer_cast<Identifier>(b)->name;
+        } else if (auto binaryA = std::dynamic_pointer_cast<BinaryOp>(a)) {
+            if (binaryA->op != std::static_pointer_cast<BinaryOp>(b)->op) return false;
+        } else if (auto unaryA = std::dynamic_pointer_cast<UnaryOp>(a)) {
+            if (unaryA->op != std::static_pointer_cast<UnaryOp>(b)->op) return false;
+        } else if (auto memberA = std::dynamic_pointer_cast<MemberAccess>(a)) {
+            if (memberA->memberName != std::static_pointer_cast<MemberAccess>(b)->memberName) return false;
+        } else if (auto callA = std::dynamic_pointer_cast<FunctionCall>(a)) {
+            auto callB = std::static_pointer_cast<FunctionCall>(b);
+            if (callA->arguments.size() != callB->arguments.size() ||
+                !equalExpressions(callA->callee, callB->callee)) {
+                return false;
+            }
+        }
+
+        std::vector<ExprPtr> childrenA;
+        std::vector<ExprPtr> childrenB;
+        forEachSubExpression(a, [&](ExprPtr& sub) { childrenA.push_back(sub); });
+        forEachSubExpression(b, [&](ExprPtr& sub) { childrenB.push_back(sub); });
+        if (childrenA.size() != childrenB.size()) return false;
+        for (size_t i = 0; i < childrenA.size(); ++i) {
+            if (!equalExpressions(childrenA[i], childrenB[i])) return false;
+        }
+        return true;
+    }
+}
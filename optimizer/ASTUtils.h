@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Small helpers shared by the optimization passes.
+namespace ASTUtils {
+    // Visits every operand slot of an expression. The callee of a plain
+    // function call is a name, not a value, so it is skipped.
+    void forEachSubExpression(const ExprPtr& expr, const std::function<void(ExprPtr&)>& fn);
+
+    // Visits the expression slots a statement owns directly (conditions,
+    // initializers, loop bounds...), without descending into nested blocks.
+    void forEachStatementExpression(const StmtPtr& stmt, const std::function<void(ExprPtr&)>& fn);
+
+    // Visits every nested statement block of a statement.
+    void forEachBlock(const StmtPtr& stmt, const std::function<void(std::vector<StmtPtr>&)>& fn);
+
+    // Name of the user-level function called, or "" for methods and non-calls.
+    std::string calledFunctionName(const ExprPtr& expr);
+
+    bool isBuiltinFunction(const std::string& name);
+    // input(), flush(), readInts() and readLines(), the builtins that do I/O
+    bool isIOBuiltin(const std::string& name);
+    bool isMutatingListMethod(const std::string& name);
+
+    // True if evaluating the expression can change program state or do I/O.
+    // Calls to user functions are assumed to have side effects.
+    bool hasSideEffects(const ExprPtr& expr);
+
+    // True if evaluating the expression can raise an error at runtime
+    // (division, indexing, string conversions).
+    bool mayTrap(const ExprPtr& expr);
+
+    // Names of all variables read by the expression.
+    void collectReads(const ExprPtr& expr, std::unordered_set<std::string>& names);
+
+    // Variables the expression assigns, writes elements of or resizes
+    // (calls to user functions are not followed).
+    void collectWrittenVariables(const ExprPtr& expr, std::unordered_set<std::string>& names);
+
+    // The strings appended by `s = ((s + a) + b)` or `s = s.concat(a)`, in
+    // order; empty for any other assignment or when a part reads s itself.
+    std::vector<ExprPtr> stringAppendParts(const std::shared_ptr<Assignment>& assignment);
+
+    // Variable at the root of an identifier or indexing chain (`grid` for
+    // `grid[i][j]`), or "" for any other expression.
+    std::string rootVariable(const ExprPtr& expr);
+
+    // Source-level spelling of a type, e.g. "list<int>".
+    std::string typeName(const TypePtr& type);
+
+    // Deep copy of an expression tree; type annotations are shared.
+    ExprPtr cloneExpression(const ExprPtr& expr);
+
+    // Number of nodes in an expression tree.
+    int expressionSize(const ExprPtr& expr);
+
+    // Structural hash and equality: two expressions are equal when they
+    // have the same shape, operators, names and literal values.
+    size_t hashExpression(const ExprPtr& expr);
+    bool equalExpressions(const ExprPtr& a, const ExprPtr& b);
+
+    struct ExpressionHash {
+        size_t operator()(const ExprPtr& expr) const { return hashExpression(expr); }
+    };
+    struct ExpressionEqual {
+        bool operator()(const ExprPtr& a, const ExprPtr& b) const { return equalExpressions(a, b); }
+    };
+}
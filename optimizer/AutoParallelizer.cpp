@@ -0,0 +1,472 @@
+#include "AutoParallelizer.h"
+#include <algorithm>
+#include "ASTUtils.h"
+
+AutoParallelizer::AutoParallelizer(long long minTrips) : minTrips(minTrips) {}
+
+void AutoParallelizer::run(const std::shared_ptr<Program>& program) {
+    effects = std::make_unique<EffectAnalysis>(program);
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            processBlock(func->body, "function '" + func->name + "'");
+        }
+    }
+    processBlock(program->statements, "the top level");
+}
+
+const std::vector<std::string>& AutoParallelizer::getParallelizedLoops() const {
+    return parallelizedLoops;
+}
+
+void AutoParallelizer::processBlock(std::vector<StmtPtr>& block, const std::string& where) {
+    for (const auto& stmt : block) {
+        if (std::dynamic_pointer_cast<Function>(stmt)) {
+            continue;
+        }
+        if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            // Loops inside a parallel one would only run inline
+            if (forStmt->parallel) {
+                continue;
+            }
+            if (tryParallelize(forStmt)) {
+                parallelizedLoops.push_back("loop over '" + forStmt->iterator + "' in " + where);
+                continue;
+            }
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { processBlock(nested, where); });
+    }
+}
+
+bool AutoParallelizer::tryParallelize(const std::shared_ptr<For>& loop) {
+    auto trips = tripCount(loop);
+    if (trips && *trips < minTrips) {
+        return false;
+    }
+
+    LoopFacts facts;
+    facts.loop = loop;
+    facts.varying.insert(loop->iterator);
+
+    // Everything the body declares or assigns, and the locals that are
+    // declared once and never assigned again
+    std::unordered_map<std::string, int> declarations;
+    std::unordered_map<std::string, ExprPtr> initializers;
+    std::function<void(const std::vector<StmtPtr>&)> collect = [&](const std::vector<StmtPtr>& block) {
+        for (const auto& stmt : block) {
+            if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+                ++declarations[varDecl->name];
+                initializers[varDecl->name] = varDecl->initializer;
+            } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+                ++declarations[forStmt->iterator];
+            } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+                ++declarations[tryCatch->exceptionName];
+            }
+            ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+                ASTUtils::collectWrittenVariables(expr, facts.assigned);
+            });
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { collect(nested); });
+        }
+    };
+    collect(loop->body);
+    for (const auto& [name, count] : declarations) {
+        facts.varying.insert(name);
+        if (count == 1 && initializers[name] && !facts.assigned.count(name)) {
+            facts.definitions[name] = initializers[name];
+        }
+    }
+    facts.varying.insert(facts.assigned.begin(), facts.assigned.end());
+
+    scanBlock(loop->body, facts, {}, {}, 0);
+    if (facts.blocked) {
+        return false;
+    }
+
+    // A name read from outside the loop is not the local of the same name
+    for (const auto& name : facts.reads) {
+        facts.definitions.erase(name);
+    }
+    for (const auto& [name, accesses] : facts.listAccesses) {
+        if (facts.writtenLists.count(name) &&
+            (facts.reads.count(name) || !sameElementsPerIteration(accesses, facts))) {
+            return false;
+        }
+    }
+    for (const auto& [name, op] : facts.reductions) {
+        if (facts.reads.count(name) || facts.listAccesses.count(name)) {
+            return false;
+        }
+    }
+
+    loop->parallel = true;
+    loop->minParallelTrips = minTrips;
+    for (const auto& [name, op] : facts.reductions) {
+        loop->reductions.emplace_back(op, name);
+    }
+    std::sort(loop->reductions.begin(), loop->reductions.end(),
+              [](const auto& a, const auto& b) { return a.second < b.second; });
+    return true;
+}
+
+void AutoParallelizer::scanBlock(const std::vector<StmtPtr>& block, LoopFacts& facts, Scope locals, InnerLoops inner,
+                                 int depth) {
+    const std::string& iterator = facts.loop->iterator;
+    auto declare = [&](Scope& scope, const std::string& name) {
+        // Shadowing would make index expressions ambiguous
+        if (name == iterator || scope.count(name) || inner.count(name)) {
+            facts.blocked = true;
+        }
+        scope.insert(name);
+    };
+    auto scan = [&](const ExprPtr& expr) { scanExpression(expr, facts, locals, inner); };
+
+    for (const auto& stmt : block) {
+        if (facts.blocked) return;
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            scan(varDecl->initializer);
+            declare(locals, varDecl->name);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            scan(forStmt->start);
+            scan(forStmt->end);
+            scan(forStmt->step);
+            Scope innerLocals = locals;
+            declare(innerLocals, forStmt->iterator);
+            InnerLoops innerLoops = inner;
+            innerLoops[forStmt->iterator] = forStmt;
+            scanBlock(forStmt->body, facts, innerLocals, innerLoops, depth + 1);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            scan(whileStmt->condition);
+            scanBlock(whileStmt->body, facts, locals, inner, depth + 1);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            if (matchExtremum(ifStmt, facts, locals, inner)) {
+                continue;
+            }
+            scan(ifStmt->condition);
+            scanBlock(ifStmt->thenBlock, facts, locals, inner, depth);
+            for (const auto& elif : ifStmt->elifBlocks) {
+                scan(elif.first);
+                scanBlock(elif.second, facts, locals, inner, depth);
+            }
+            scanBlock(ifStmt->elseBlock, facts, locals, inner, depth);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            scanBlock(tryCatch->tryBlock, facts, locals, inner, depth);
+            Scope catchLocals = locals;
+            declare(catchLocals, tryCatch->exceptionName);
+            scanBlock(tryCatch->catchBlock, facts, catchLocals, inner, depth);
+        } else if (std::dynamic_pointer_cast<Print>(stmt) || std::dynamic_pointer_cast<Input>(stmt) ||
+                   std::dynamic_pointer_cast<Return>(stmt)) {
+            facts.blocked = true;
+        } else if (std::dynamic_pointer_cast<ENDLOOP>(stmt)) {
+            facts.blocked = facts.blocked || depth == 0;
+        } else {
+            ASTUtils::forEachStatementExpression(stmt, scan);
+        }
+    }
+}
+
+void AutoParallelizer::scanExpression(const ExprPtr& expr, LoopFacts& facts, const Scope& locals,
+                                      const InnerLoops& inner) {
+    if (!expr || facts.blocked) return;
+    const std::string& iterator = facts.loop->iterator;
+    auto scan = [&](const ExprPtr& sub) { scanExpression(sub, facts, locals, inner); };
+    // Scans the indices of `list[a][b]...`, and records `a` for a shared list
+    auto scanIndexing = [&](const ExprPtr& access, const std::string& root) {
+        ExprPtr node = access;
+        ExprPtr first;
+        while (auto listAccess = std::dynamic_pointer_cast<::ListAccess>(node)) {
+            scan(listAccess->index);
+            first = listAccess->index;
+            node = listAccess->list;
+        }
+        facts.listAccesses[root].push_back({first, inner});
+    };
+
+    if (mayThrow(expr)) {
+        // Later iterations could already have run when one throws
+        facts.blocked = true;
+        return;
+    }
+
+    if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        if (auto target = std::dynamic_pointer_cast<Identifier>(assignment->target)) {
+            if (locals.count(target->name)) {
+                scan(assignment->value);
+                return;
+            }
+            // s = s + e or s = s * e on a shared int
+            auto value = std::dynamic_pointer_cast<BinaryOp>(assignment->value);
+            if (target->name != iterator && value &&
+                (value->op == BinaryOp::Operator::ADD || value->op == BinaryOp::Operator::MUL)) {
+                for (const auto& [self, other] : {std::pair(value->left, value->right),
+                                                   std::pair(value->right, value->left)}) {
+                    auto ident = std::dynamic_pointer_cast<Identifier>(self);
+                    std::unordered_set<std::string> otherReads;
+                    ASTUtils::collectReads(other, otherReads);
+                    if (ident && ident->name == target->name && ident->type &&
+                        ident->type->kind == Type::Kind::INT && !otherReads.count(target->name)) {
+                        addReduction(facts, target->name, value->op);
+                        scan(other);
+                        return;
+                    }
+                }
+            }
+            facts.blocked = true;
+            return;
+        }
+
+        std::string root = ASTUtils::rootVariable(assignment->target);
+        if (root.empty()) {
+            facts.blocked = true;
+        } else if (locals.count(root)) {
+            scan(assignment->target);
+        } else {
+            facts.writtenLists.insert(root);
+            scanIndexing(assignment->target, root);
+        }
+        scan(assignment->value);
+        return;
+    }
+
+    if (std::dynamic_pointer_cast<::ListAccess>(expr)) {
+        std::string root = ASTUtils::rootVariable(expr);
+        if (!root.empty() && !locals.count(root) && root != iterator) {
+            scanIndexing(expr, root);
+            return;
+        }
+    }
+
+    if (auto identifier = std::dynamic_pointer_cast<Identifier>(expr)) {
+        if (!locals.count(identifier->name) && identifier->name != iterator) {
+            facts.reads.insert(identifier->name);
+        }
+        return;
+    }
+
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+            std::string root = ASTUtils::rootVariable(member->object);
+            if (ASTUtils::isMutatingListMethod(member->memberName) && (root.empty() || !locals.count(root))) {
+                facts.blocked = true;
+                return;
+            }
+            // The length of a list never changes inside the loop
+            if (member->memberName == "length" && std::dynamic_pointer_cast<Identifier>(member->object)) {
+                return;
+            }
+        } else {
+            std::string name = ASTUtils::calledFunctionName(call);
+            // calledFunctionName() is empty for builtins
+            auto callee = std::dynamic_pointer_cast<Identifier>(call->callee);
+            if (callee && ASTUtils::isIOBuiltin(callee->name)) {
+                facts.blocked = true;
+                return;
+            }
+            if (!name.empty() && !ASTUtils::isBuiltinFunction(name)) {
+                const FunctionEffects& calleeEffects = effects->effectsOf(name);
+                if (calleeEffects.performsIO || !calleeEffects.writtenGlobals.empty()) {
+                    facts.blocked = true;
+                    return;
+                }
+                for (size_t param : calleeEffects.mutatedParams) {
+                    std::string root =
+                        param < call->arguments.size() ? ASTUtils::rootVariable(call->arguments[param]) : "";
+                    if (root.empty() || !locals.count(root)) {
+                        facts.blocked = true;
+                        return;
+                    }
+                }
+                facts.reads.insert(calleeEffects.readGlobals.begin(), calleeEffects.readGlobals.end());
+            }
+        }
+    }
+
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { scan(sub); });
+}
+
+bool AutoParallelizer::matchExtremum(const std::shared_ptr<If>& ifStmt, LoopFacts& facts, const Scope& locals,
+                                     const InnerLoops& inner) {
+    // if (e > m) { m = e; }, and the other three ways of writing a maximum
+    // or minimum
+    if (!ifStmt->elifBlocks.empty() || !ifStmt->elseBlock.empty() || ifStmt->thenBlock.size() != 1) {
+        return false;
+    }
+    auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(ifStmt->thenBlock[0]);
+    auto assignment = exprStmt ? std::dynamic_pointer_cast<Assignment>(exprStmt->expression) : nullptr;
+    auto target = assignment ? std::dynamic_pointer_cast<Identifier>(assignment->target) : nullptr;
+    auto condition = std::dynamic_pointer_cast<BinaryOp>(ifStmt->condition);
+    if (!target || !condition || locals.count(target->name) || target->name == facts.loop->iterator) {
+        return false;
+    }
+
+    using Op = BinaryOp::Operator;
+    bool greater = condition->op == Op::GT || condition->op == Op::GE;
+    bool less = condition->op == Op::LT || condition->op == Op::LE;
+    auto isTarget = [&](const ExprPtr& side) {
+        auto ident = std::dynamic_pointer_cast<Identifier>(side);
+        return ident && ident->name == target->name && ident->type &&
+               (ident->type->kind == Type::Kind::INT || ident->type->kind == Type::Kind::FLOAT);
+    };
+    std::optional<Op> op;
+    if ((greater || less) && isTarget(condition->right) &&
+        ASTUtils::equalExpressions(condition->left, assignment->value)) {
+        op = greater ? Op::GT : Op::LT;
+    } else if ((greater || less) && isTarget(condition->left) &&
+               ASTUtils::equalExpressions(condition->right, assignment->value)) {
+        op = less ? Op::GT : Op::LT;
+    }
+    std::unordered_set<std::string> valueReads;
+    ASTUtils::collectReads(assignment->value, valueReads);
+    if (!op || valueReads.count(target->name) || ASTUtils::hasSideEffects(assignment->value)) {
+        return false;
+    }
+
+    addReduction(facts, target->name, *op);
+    scanExpression(assignment->value, facts, locals, inner);
+    return true;
+}
+
+void AutoParallelizer::addReduction(LoopFacts& facts, const std::string& name, BinaryOp::Operator op) {
+    auto [it, inserted] = facts.reductions.emplace(name, op);
+    if (!inserted && it->second != op) {
+        facts.blocked = true;
+    }
+}
+
+bool AutoParallelizer::isInvariant(const ExprPtr& expr, const LoopFacts& facts) const {
+    if (ASTUtils::hasSideEffects(expr)) return false;
+    std::unordered_set<std::string> reads;
+    ASTUtils::collectReads(expr, reads);
+    return std::none_of(reads.begin(), reads.end(),
+                        [&](const std::string& name) { return facts.varying.count(name) > 0; });
+}
+
+ExprPtr AutoParallelizer::expand(const ExprPtr& expr, const LoopFacts& facts, int depth) const {
+    // Substitutes single-assignment locals, so `int k = i * n + j; a[k]`
+    // is matched like `a[i * n + j]`
+    if (auto identifier = std::dynamic_pointer_cast<Identifier>(expr)) {
+        auto definition = facts.definitions.find(identifier->name);
+        if (definition != facts.definitions.end() && depth < 8) {
+            return expand(definition->second, facts, depth + 1);
+        }
+    }
+    ExprPtr copy = ASTUtils::cloneExpression(expr);
+    ASTUtils::forEachSubExpression(copy, [&](ExprPtr& sub) { sub = expand(sub, facts, depth); });
+    return copy;
+}
+
+std::optional<long long> AutoParallelizer::coefficient(const ExprPtr& expr, const LoopFacts& facts) const {
+    // Multiple of the loop iterator in an affine expression `a * i + b`
+    using Op = BinaryOp::Operator;
+    if (auto identifier = std::dynamic_pointer_cast<Identifier>(expr); identifier &&
+        identifier->name == facts.loop->iterator) {
+        return 1;
+    }
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        auto left = coefficient(binaryOp->left, facts);
+        auto right = coefficient(binaryOp->right, facts);
+        if (left && right) {
+            if (binaryOp->op == Op::ADD) return *left + *right;
+            if (binaryOp->op == Op::SUB) return *left - *right;
+            if (binaryOp->op == Op::MUL) {
+                auto constant = [](const ExprPtr& side) -> std::optional<long long> {
+                    auto literal = std::dynamic_pointer_cast<Literal>(side);
+                    if (literal && std::holds_alternative<int>(literal->value)) return std::get<int>(literal->value);
+                    return std::nullopt;
+                };
+                if (*left == 0 && *right == 0) return 0;
+                if (auto k = constant(binaryOp->left)) return *k * *right;
+                if (auto k = constant(binaryOp->right)) return *left * *k;
+            }
+        }
+    } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr); unaryOp &&
+               unaryOp->op == UnaryOp::Operator::MINUS) {
+        if (auto operand = coefficient(unaryOp->operand, facts)) return -*operand;
+    }
+    if (isInvariant(expr, facts)) {
+        return 0;
+    }
+    return std::nullopt;
+}
+
+ExprPtr AutoParallelizer::blockExtent(const ExprPtr& index, const LoopFacts& facts, const InnerLoops& inner) const {
+    auto sum = std::dynamic_pointer_cast<BinaryOp>(index);
+    if (!sum || sum->op != BinaryOp::Operator::ADD) {
+        return nullptr;
+    }
+    for (const auto& [offset, scaled] : {std::pair(sum->left, sum->right), std::pair(sum->right, sum->left)}) {
+        auto j = std::dynamic_pointer_cast<Identifier>(offset);
+        auto product = std::dynamic_pointer_cast<BinaryOp>(scaled);
+        if (!j || !inner.count(j->name) || facts.assigned.count(j->name) || !product ||
+            product->op != BinaryOp::Operator::MUL) {
+            continue;
+        }
+        for (const auto& [i, extent] : {std::pair(product->left, product->right),
+                                         std::pair(product->right, product->left)}) {
+            auto iterator = std::dynamic_pointer_cast<Identifier>(i);
+            if (!iterator || iterator->name != facts.loop->iterator || !isInvariant(extent, facts)) {
+                continue;
+            }
+            // j must stay in [0, extent): an upward loop from 0 to the extent
+            const auto& innerLoop = inner.at(j->name);
+            auto start = std::dynamic_pointer_cast<Literal>(innerLoop->start);
+            auto step = std::dynamic_pointer_cast<Literal>(innerLoop->step);
+            bool fromZero = start && std::holds_alternative<int>(start->value) && std::get<int>(start->value) == 0;
+            bool upward = !innerLoop->step || (step && std::holds_alternative<int>(step->value) &&
+                                               std::get<int>(step->value) > 0);
+            if (fromZero && upward && ASTUtils::equalExpressions(innerLoop->end, extent)) {
+                return extent;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool AutoParallelizer::sameElementsPerIteration(const std::vector<IndexedAccess>& accesses,
+                                                const LoopFacts& facts) const {
+    // Every access must name the same element (or block of elements) as a
+    // function of the iterator, and different iterations different ones
+    ExprPtr affine;
+    ExprPtr extent;
+    for (const auto& access : accesses) {
+        ExprPtr index = expand(access.index, facts);
+        auto scale = coefficient(index, facts);
+        if (scale && *scale != 0) {
+            if (extent || (affine && !ASTUtils::equalExpressions(affine, index))) return false;
+            affine = index;
+        } else if (ExprPtr block = blockExtent(index, facts, access.inner)) {
+            if (affine || (extent && !ASTUtils::equalExpressions(extent, block))) return false;
+            extent = block;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<long long> AutoParallelizer::tripCount(const std::shared_ptr<For>& loop) {
+    auto constant = [](const ExprPtr& expr) -> std::optional<long long> {
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            if (std::holds_alternative<int>(literal->value)) return std::get<int>(literal->value);
+        } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+            auto literal = std::dynamic_pointer_cast<Literal>(unaryOp->operand);
+            if (unaryOp->op == UnaryOp::Operator::MINUS && literal && std::holds_alternative<int>(literal->value)) {
+                return -static_cast<long long>(std::get<int>(literal->value));
+            }
+        }
+        return std::nullopt;
+    };
+    auto start = constant(loop->start);
+    auto end = constant(loop->end);
+    long long step = loop->step ? constant(loop->step).value_or(1) : 1;
+    if (!start || !end || step <= 0) {
+        return std::nullopt;
+    }
+    return (std::max(*start, *end) - std::min(*start, *end) + step - 1) / step;
+}
+
+bool AutoParallelizer::mayThrow(const ExprPtr& expr) const {
+    if (EffectAnalysis::trapsAt(expr)) {
+        return true;
+    }
+    std::string name = ASTUtils::calledFunctionName(expr);
+    return !name.empty() && effects->effectsOf(name).mayTrap;
+}
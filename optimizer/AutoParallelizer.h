@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+#include "EffectAnalysis.h"
+
+// Turns `for` loops whose iterations are independent into `parallel for`
+// loops. A loop qualifies when every shared list it writes is only accessed
+// at one index per iteration that no other iteration touches (`a * i + b`
+// for a constant a, or `i * c + j` with an inner loop j from 0 to c), every
+// shared scalar it writes is an int sum or product (`s = s + e`) or an int
+// or float maximum or minimum (`if (e > m) { m = e; }`) read nowhere else,
+// and nothing in it can print, read input, throw, leave the loop or change
+// state through a function call. Loops nested in a parallelized loop are
+// left alone, and so are loops known to run fewer than minTrips times;
+// shorter runs of the others stay on one thread at run time.
+class AutoParallelizer {
+public:
+    explicit AutoParallelizer(long long minTrips);
+    void run(const std::shared_ptr<Program>& program);
+    const std::vector<std::string>& getParallelizedLoops() const;
+
+private:
+    using Scope = std::unordered_set<std::string>;
+    using InnerLoops = std::unordered_map<std::string, std::shared_ptr<For>>;
+
+    // First index of an access to a shared list, with the loops around it
+    struct IndexedAccess {
+        ExprPtr index;
+        InnerLoops inner;
+    };
+
+    // What one candidate loop's body does to variables declared outside it
+    struct LoopFacts {
+        std::shared_ptr<For> loop;
+        bool blocked = false;
+        // Declared or assigned anywhere in the body, so not loop-invariant
+        std::unordered_set<std::string> varying;
+        std::unordered_set<std::string> assigned;
+        // Locals initialized once and never reassigned, looked through
+        // when matching index expressions
+        std::unordered_map<std::string, ExprPtr> definitions;
+        std::unordered_map<std::string, std::vector<IndexedAccess>> listAccesses;
+        std::unordered_set<std::string> writtenLists;
+        // Shared variables read other than through an index or `.length()`
+        std::unordered_set<std::string> reads;
+        std::unordered_map<std::string, BinaryOp::Operator> reductions;
+    };
+
+    long long minTrips;
+    std::unique_ptr<EffectAnalysis> effects;
+    std::vector<std::string> parallelizedLoops;
+
+    void processBlock(std::vector<StmtPtr>& block, const std::string& where);
+    bool tryParallelize(const std::shared_ptr<For>& loop);
+
+    void scanBlock(const std::vector<StmtPtr>& block, LoopFacts& facts, Scope locals, InnerLoops inner, int depth);
+    void scanExpression(const ExprPtr& expr, LoopFacts& facts, const Scope& locals, const InnerLoops& inner);
+    bool matchExtremum(const std::shared_ptr<If>& ifStmt, LoopFacts& facts, const Scope& locals,
+                       const InnerLoops& inner);
+    void addReduction(LoopFacts& facts, const std::string& name, BinaryOp::Operator op);
+
+    bool isInvariant(const ExprPtr& expr, const LoopFacts& facts) const;
+    ExprPtr expand(const ExprPtr& expr, const LoopFacts& facts, int depth = 0) const;
+    std::optional<long long> coefficient(const ExprPtr& expr, const LoopFacts& facts) const;
+    // The inner loop's upper bound c when the index is `i * c + j`
+    ExprPtr blockExtent(const ExprPtr& index, const LoopFacts& facts, const InnerLoops& inner) const;
+    bool sameElementsPerIteration(const std::vector<IndexedAccess>& accesses, const LoopFacts& facts) const;
+
+    static std::optional<long long> tripCount(const std::shared_ptr<For>& loop);
+    // This node, or the user function it calls, may raise an error
+    bool mayThrow(const ExprPtr& expr) const;
+};
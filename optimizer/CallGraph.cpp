@@ -0,0 +1,97 @@
+#include "CallGraph.h"
+#include "ASTUtils.h"
+#include <functional>
+
+CallGraph::CallGraph(const std::shared_ptr<Program>& program) {
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            functions[func->name] = func;
+            declarationOrder.push_back(func->name);
+        }
+    }
+
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            auto& calls = callees[func->name];
+            for (const auto& bodyStmt : func->body) {
+                collectCalls(bodyStmt, calls);
+            }
+        } else {
+            collectCalls(stmt, rootCallees);
+        }
+    }
+}
+
+void CallGraph::collectCalls(const StmtPtr& stmt, std::unordered_set<std::string>& calls) const {
+    ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { collectCalls(expr, calls); });
+    ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& block) {
+        for (const auto& s : block) {
+            collectCalls(s, calls);
+        }
+    });
+}
+
+void CallGraph::collectCalls(const ExprPtr& expr, std::unordered_set<std::string>& calls) const {
+    if (!expr) return;
+    std::string name = ASTUtils::calledFunctionName(expr);
+    if (!name.empty() && functions.count(name)) {
+        calls.insert(name);
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { collectCalls(sub, calls); });
+}
+
+std::shared_ptr<Function> CallGraph::getFunction(const std::string& name) const {
+    auto it = functions.find(name);
+    return it != functions.end() ? it->second : nullptr;
+}
+
+const std::unordered_set<std::string>& CallGraph::calleesOf(const std::string& name) const {
+    static const std::unordered_set<std::string> none;
+    auto it = callees.find(name);
+    return it != callees.end() ? it->second : none;
+}
+
+std::unordered_set<std::string> CallGraph::reachableFunctions() const {
+    std::unordered_set<std::string> reached;
+    std::vector<std::string> worklist(rootCallees.begin(), rootCallees.end());
+    while (!worklist.empty()) {
+        std::string name = worklist.back();
+        worklist.pop_back();
+        if (!reached.insert(name).second) continue;
+        for (const auto& callee : calleesOf(name)) {
+            worklist.push_back(callee);
+        }
+    }
+    return reached;
+}
+
+bool CallGraph::isRecursive(const std::string& name) const {
+    std::unordered_set<std::string> visited;
+    std::vector<std::string> worklist(calleesOf(name).begin(), calleesOf(name).end());
+    while (!worklist.empty()) {
+        std::string current = worklist.back();
+        worklist.pop_back();
+        if (current == name) return true;
+        if (!visited.insert(current).second) continue;
+        for (const auto& callee : calleesOf(current)) {
+            worklist.push_back(callee);
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> CallGraph::bottomUpOrder() const {
+    std::vector<std::string> order;
+    std::unordered_set<std::string> visited;
+    std::function<void(const std::string&)> visit = [&](const std::string& name) {
+        if (!visited.insert(name).second) return;
+        for (const auto& callee : calleesOf(name)) {
+            visit(callee);
+        }
+        order.push_back(name);
+    };
+    for (const auto& name : declarationOrder) {
+        visit(name);
+    }
+    return order;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Whole-program call graph over user-defined functions. Top-level
+// statements act as the single root of the graph.
+class CallGraph {
+public:
+    explicit CallGraph(const std::shared_ptr<Program>& program);
+
+    std::shared_ptr<Function> getFunction(const std::string& name) const;
+    const std::unordered_set<std::string>& calleesOf(const std::string& name) const;
+
+    // Functions transitively called from the top-level statements.
+    std::unordered_set<std::string> reachableFunctions() const;
+
+    // True if the function can (transitively) call itself.
+    bool isRecursive(const std::string& name) const;
+
+    // Functions ordered so that callees come before their callers
+    // (members of a recursive cycle are ordered arbitrarily).
+    std::vector<std::string> bottomUpOrder() const;
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<Function>> functions;
+    std::vector<std::string> declarationOrder;
+    std::unordered_map<std::string, std::unordered_set<std::string>> callees;
+    std::unordered_set<std::string> rootCallees;
+
+    void collectCalls(const StmtPtr& stmt, std::unordered_set<std::string>& calls) const;
+    void collectCalls(const ExprPtr& expr, std::unordered_set<std::string>& calls) const;
+};
@@ -0,0 +1,366 @@
+#include "CommonSubexpressionEliminator.h"
+#include <functional>
+
+static const std::string TEMP_PREFIX = "__cse";
+
+static bool containsNode(const ExprPtr& expr, const Expression* target) {
+    if (!expr) return false;
+    if (expr.get() == target) return true;
+    bool found = false;
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) {
+        if (!found && containsNode(sub, target)) found = true;
+    });
+    return found;
+}
+
+void CommonSubexpressionEliminator::run(const std::shared_ptr<Program>& program) {
+    effects = std::make_unique<EffectAnalysis>(program);
+    pendingDecls.clear();
+    processBlock(program->statements, Available(), true);
+    insertPendingDecls(program->statements, true);
+}
+
+int CommonSubexpressionEliminator::getReusedCount() const {
+    return reusedCount;
+}
+
+void CommonSubexpressionEliminator::processBlock(std::vector<StmtPtr>& block, Available available,
+                                                 bool programLevel) {
+    for (auto& stmt : block) {
+        Statement* current = stmt.get();
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            processBlock(func->body, Available(), false);
+            continue;
+        }
+
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { applyCopies(expr); });
+
+        // A first occurrence is computed ahead of its statement, which is
+        // only safe when nothing else in the statement has side effects
+        bool anchorable = true;
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+            if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+                anchorable = anchorable && isPure(assignment->target) && isPure(assignment->value);
+            } else {
+                anchorable = anchorable && isPure(expr);
+            }
+        });
+        Statement* anchor = anchorable ? current : nullptr;
+
+        Writes writes;
+        collectWrites(stmt, writes);
+
+        if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            // The condition runs on every iteration: it may reuse values the
+            // loop never invalidates but cannot introduce new ones
+            kill(available, writes, nullptr);
+            rewriteExpression(whileStmt->condition, available, nullptr, false);
+            processBlock(whileStmt->body, available, false);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            rewriteExpression(forStmt->start, available, anchor, false);
+            rewriteExpression(forStmt->end, available, anchor, false);
+            rewriteExpression(forStmt->step, available, anchor, false);
+            kill(available, writes, nullptr);
+            processBlock(forStmt->body, available, false);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            rewriteExpression(ifStmt->condition, available, anchor, false);
+            processBlock(ifStmt->thenBlock, available, false);
+            for (auto& elif : ifStmt->elifBlocks) {
+                rewriteExpression(elif.first, available, nullptr, true);
+                processBlock(elif.second, available, false);
+            }
+            processBlock(ifStmt->elseBlock, available, false);
+            kill(available, writes, nullptr);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            processBlock(tryCatch->tryBlock, available, false);
+            processBlock(tryCatch->catchBlock, available, false);
+            kill(available, writes, nullptr);
+        } else if (programLevel && std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            // The C++ backend evaluates top-level initializers at the start
+            // of main, ahead of every temporary the other statements assign
+            kill(available, writes, current);
+        } else {
+            ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+                rewriteExpression(expr, available, anchor, false);
+            });
+
+            if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+                if (isTemporaryCopy(varDecl)) {
+                    // One temporary now just copies another: use the original
+                    copies[varDecl->name] = std::static_pointer_cast<Identifier>(varDecl->initializer)->name;
+                    removedDecls.insert(current);
+                    continue;
+                }
+                // The C++ backend initializes top-level declarations early,
+                // so their variables may not hold the value at this point
+                if (varDecl->initializer && !programLevel && !varDecl->isConst) {
+                    recordHolder(varDecl->initializer, varDecl->name, varDecl->type, current, available);
+                }
+            } else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
+                auto assignment = std::dynamic_pointer_cast<Assignment>(exprStmt->expression);
+                auto target = assignment ? std::dynamic_pointer_cast<Identifier>(assignment->target) : nullptr;
+                if (target) {
+                    recordHolder(assignment->value, target->name, target->type, current, available);
+                }
+            }
+            kill(available, writes, current);
+        }
+    }
+}
+
+void CommonSubexpressionEliminator::rewriteExpression(ExprPtr& expr, Available& available, Statement* anchor,
+                                                      bool conditional) {
+    if (!expr) return;
+    if (isCandidate(expr)) {
+        auto it = available.find(expr);
+        if (it != available.end() && materialize(*it->second)) {
+            auto reuse = std::make_shared<Identifier>(it->second->holder);
+            reuse->type = expr->type;
+            reuse->line = expr->line;
+            reuse->column = expr->column;
+            expr = reuse;
+            ++reusedCount;
+            return;
+        }
+        if (it == available.end() && anchor && !conditional) {
+            auto entry = describe(expr);
+            entry->slot = &expr;
+            entry->anchor = anchor;
+            available.emplace(ASTUtils::cloneExpression(expr), entry);
+        }
+    }
+
+    // An assignment target is a location, not a value: only its indices are reused
+    if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        ASTUtils::forEachSubExpression(assignment->target, [&](ExprPtr& sub) {
+            rewriteExpression(sub, available, anchor, conditional);
+        });
+        rewriteExpression(assignment->value, available, anchor, conditional);
+        return;
+    }
+    // The right operand of and/or is not always evaluated
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        if (binaryOp->op == BinaryOp::Operator::AND || binaryOp->op == BinaryOp::Operator::OR) {
+            rewriteExpression(binaryOp->left, available, anchor, conditional);
+            rewriteExpression(binaryOp->right, available, anchor, true);
+            return;
+        }
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) {
+        rewriteExpression(sub, available, anchor, conditional);
+    });
+}
+
+void CommonSubexpressionEliminator::applyCopies(const ExprPtr& expr) {
+    if (!expr || copies.empty()) return;
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        auto copy = copies.find(ident->name);
+        if (copy != copies.end()) ident->name = copy->second;
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { applyCopies(sub); });
+}
+
+void CommonSubexpressionEliminator::recordHolder(const ExprPtr& expr, const std::string& name, const TypePtr& type,
+                                                 Statement* anchor, Available& available) {
+    // A float variable must not stand in for an int expression, and so on
+    if (!isCandidate(expr) || !type || type->kind != expr->type->kind) return;
+
+    auto it = available.find(expr);
+    if (it != available.end()) {
+        if (it->second->anchor == anchor && it->second->holder.empty()) {
+            it->second->holder = name;
+            it->second->slot = nullptr;
+        }
+        return;
+    }
+    auto entry = describe(expr);
+    entry->anchor = anchor;
+    entry->holder = name;
+    available.emplace(ASTUtils::cloneExpression(expr), entry);
+}
+
+bool CommonSubexpressionEliminator::materialize(Entry& entry) {
+    if (!entry.holder.empty()) return true;
+    if (!entry.slot) return false;
+
+    ExprPtr value = *entry.slot;
+    std::string name = TEMP_PREFIX + std::to_string(tempCounter++);
+    auto decl = std::make_shared<VarDecl>(false, value->type, name, value);
+
+    // Keep declarations in dependency order: the value may sit inside an
+    // expression that an earlier temporary already took over
+    auto& decls = pendingDecls[entry.anchor];
+    auto position = decls.begin();
+    while (position != decls.end() && !containsNode((*position)->initializer, value.get())) {
+        ++position;
+    }
+    decls.insert(position, decl);
+
+    auto temp = std::make_shared<Identifier>(name);
+    temp->type = value->type;
+    temp->line = value->line;
+    temp->column = value->column;
+    *entry.slot = temp;
+
+    entry.holder = name;
+    entry.slot = nullptr;
+    return true;
+}
+
+void CommonSubexpressionEliminator::insertPendingDecls(std::vector<StmtPtr>& block, bool programLevel) {
+    std::vector<StmtPtr> result;
+    for (const auto& stmt : block) {
+        if (removedDecls.count(stmt.get())) continue;
+        auto it = pendingDecls.find(stmt.get());
+        if (it != pendingDecls.end()) {
+            for (const auto& decl : it->second) {
+                if (programLevel) {
+                    // Declared without a value and assigned in place, as the
+                    // C++ backend hoists top-level initializers
+                    auto target = std::make_shared<Identifier>(decl->name);
+                    target->type = decl->type;
+                    auto assignment = std::make_shared<Assignment>(target, decl->initializer);
+                    assignment->Expression::type = decl->type;
+                    result.push_back(std::make_shared<VarDecl>(false, decl->type, decl->name, nullptr));
+                    result.push_back(std::make_shared<ExpressionStatement>(assignment));
+                } else {
+                    result.push_back(decl);
+                }
+            }
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { insertPendingDecls(nested, false); });
+        result.push_back(stmt);
+    }
+    block = std::move(result);
+}
+
+bool CommonSubexpressionEliminator::isTemporaryCopy(const std::shared_ptr<VarDecl>& varDecl) {
+    // Compiler temporaries are assigned exactly once, so a copy of one can
+    // be replaced by the original everywhere
+    auto source = std::dynamic_pointer_cast<Identifier>(varDecl->initializer);
+    return source && varDecl->name.rfind("__", 0) == 0 && source->name.rfind("__", 0) == 0;
+}
+
+bool CommonSubexpressionEliminator::isCandidate(const ExprPtr& expr) const {
+    if (!expr->type) return false;
+    Type::Kind kind = expr->type->kind;
+    // Sharing a list or matrix would alias it in Python and copy it in C++
+    if (kind == Type::Kind::LIST || kind == Type::Kind::MATRIX || kind == Type::Kind::VOID ||
+        kind == Type::Kind::MATHOBJECT) {
+        return false;
+    }
+
+    if (!std::dynamic_pointer_cast<BinaryOp>(expr) && !std::dynamic_pointer_cast<UnaryOp>(expr) &&
+        !std::dynamic_pointer_cast<FunctionCall>(expr) && !std::dynamic_pointer_cast<ListAccess>(expr)) {
+        return false;
+    }
+    return ASTUtils::expressionSize(expr) >= 3 && isPure(expr);
+}
+
+bool CommonSubexpressionEliminator::isPure(const ExprPtr& expr) const {
+    if (!expr) return true;
+    if (std::dynamic_pointer_cast<Assignment>(expr)) return false;
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        if (auto ident = std::dynamic_pointer_cast<Identifier>(call->callee)) {
+            if (ASTUtils::isIOBuiltin(ident->name)) return false;
+            if (!ASTUtils::isBuiltinFunction(ident->name) && !effects->isPure(ident->name)) return false;
+        } else if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+            if (ASTUtils::isMutatingListMethod(member->memberName)) return false;
+        }
+    }
+    bool pure = true;
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) {
+        if (pure && !isPure(sub)) pure = false;
+    });
+    return pure;
+}
+
+std::shared_ptr<CommonSubexpressionEliminator::Entry> CommonSubexpressionEliminator::describe(
+        const ExprPtr& expr) const {
+    auto entry = std::make_shared<Entry>();
+    ASTUtils::collectReads(expr, entry->reads);
+
+    std::function<void(const ExprPtr&)> visit = [&](const ExprPtr& e) {
+        if (std::dynamic_pointer_cast<ListAccess>(e)) {
+            entry->readsLists = true;
+        } else if (auto ident = std::dynamic_pointer_cast<Identifier>(e)) {
+            if (ident->type && (ident->type->kind == Type::Kind::LIST || ident->type->kind == Type::Kind::MATRIX)) {
+                entry->readsLists = true;
+            }
+        } else {
+            std::string callee = ASTUtils::calledFunctionName(e);
+            if (!callee.empty()) {
+                // A pure function may still read global lists
+                const FunctionEffects& calleeEffects = effects->effectsOf(callee);
+                entry->reads.insert(calleeEffects.readGlobals.begin(), calleeEffects.readGlobals.end());
+                entry->readsLists = true;
+            }
+        }
+        ASTUtils::forEachSubExpression(e, [&](ExprPtr& sub) { visit(sub); });
+    };
+    visit(expr);
+    return entry;
+}
+
+void CommonSubexpressionEliminator::collectWrites(const StmtPtr& stmt, Writes& writes) const {
+    if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+        writes.names.insert(varDecl->name);
+    } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+        writes.names.insert(forStmt->iterator);
+    } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+        writes.names.insert(tryCatch->exceptionName);
+    } else if (std::dynamic_pointer_cast<Function>(stmt)) {
+        return;
+    }
+    ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { collectWrites(expr, writes); });
+    ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+        for (const auto& s : nested) {
+            collectWrites(s, writes);
+        }
+    });
+}
+
+void CommonSubexpressionEliminator::collectWrites(const ExprPtr& expr, Writes& writes) const {
+    if (!expr) return;
+    if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        std::string root = ASTUtils::rootVariable(assignment->target);
+        if (!root.empty()) writes.names.insert(root);
+        if (!std::dynamic_pointer_cast<Identifier>(assignment->target)) writes.listContents = true;
+    } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+            if (ASTUtils::isMutatingListMethod(member->memberName)) {
+                std::string root = ASTUtils::rootVariable(member->object);
+                if (!root.empty()) writes.names.insert(root);
+                writes.listContents = true;
+            }
+        }
+        std::string callee = ASTUtils::calledFunctionName(call);
+        if (!callee.empty()) {
+            const FunctionEffects& calleeEffects = effects->effectsOf(callee);
+            writes.names.insert(calleeEffects.writtenGlobals.begin(), calleeEffects.writtenGlobals.end());
+            for (size_t index : calleeEffects.mutatedParams) {
+                if (index < call->arguments.size()) {
+                    std::string root = ASTUtils::rootVariable(call->arguments[index]);
+                    if (!root.empty()) writes.names.insert(root);
+                }
+            }
+            if (!calleeEffects.writtenGlobals.empty() || !calleeEffects.mutatedParams.empty()) {
+                writes.listContents = true;
+            }
+        }
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { collectWrites(sub, writes); });
+}
+
+void CommonSubexpressionEliminator::kill(Available& available, const Writes& writes, const Statement* current) {
+    for (auto it = available.begin(); it != available.end();) {
+        const Entry& entry = *it->second;
+        bool dead = writes.listContents && entry.readsLists;
+        for (const auto& name : writes.names) {
+            if (dead) break;
+            // The statement that defines a holder variable does not invalidate it
+            dead = entry.reads.count(name) > 0 || (name == entry.holder && entry.anchor != current);
+        }
+        it = dead ? available.erase(it) : std::next(it);
+    }
+}
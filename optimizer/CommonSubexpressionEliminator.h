@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+#include "ASTUtils.h"
+#include "EffectAnalysis.h"
+
+// Reuses the value of a pure expression (including calls to pure user
+// functions) that was already computed earlier in the same block or in a
+// block that dominates it. Expressions are matched by structure. A value
+// computed as the whole initializer of a variable is reused through that
+// variable; otherwise it is stored in a __cseN temporary declared before
+// the statement that first computes it.
+class CommonSubexpressionEliminator {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    int getReusedCount() const;
+
+private:
+    struct Entry {
+        // Where the first occurrence lives, or null if it cannot be stored
+        ExprPtr* slot = nullptr;
+        Statement* anchor = nullptr;
+        std::string holder;
+        std::unordered_set<std::string> reads;
+        bool readsLists = false;
+    };
+    using Available = std::unordered_map<ExprPtr, std::shared_ptr<Entry>,
+                                         ASTUtils::ExpressionHash, ASTUtils::ExpressionEqual>;
+
+    struct Writes {
+        std::unordered_set<std::string> names;
+        bool listContents = false;
+    };
+
+    std::unique_ptr<EffectAnalysis> effects;
+    std::unordered_map<Statement*, std::vector<std::shared_ptr<VarDecl>>> pendingDecls;
+    // Temporaries that turned into copies of another temporary
+    std::unordered_map<std::string, std::string> copies;
+    std::unordered_set<const Statement*> removedDecls;
+    int tempCounter = 0;
+    int reusedCount = 0;
+
+    void processBlock(std::vector<StmtPtr>& block, Available available, bool programLevel);
+    void rewriteExpression(ExprPtr& expr, Available& available, Statement* anchor, bool conditional);
+    void applyCopies(const ExprPtr& expr);
+    void recordHolder(const ExprPtr& expr, const std::string& name, const TypePtr& type,
+                      Statement* anchor, Available& available);
+    bool materialize(Entry& entry);
+    void insertPendingDecls(std::vector<StmtPtr>& block, bool programLevel);
+
+    static bool isTemporaryCopy(const std::shared_ptr<VarDecl>& varDecl);
+    bool isCandidate(const ExprPtr& expr) const;
+    bool isPure(const ExprPtr& expr) const;
+    std::shared_ptr<Entry> describe(const ExprPtr& expr) const;
+
+    void collectWrites(const StmtPtr& stmt, Writes& writes) const;
+    void collectWrites(const ExprPtr& expr, Writes& writes) const;
+    static void kill(Available& available, const Writes& writes, const Statement* current);
+};
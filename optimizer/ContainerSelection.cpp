@@ -0,0 +1,271 @@
+#include "ContainerSelection.h"
+#include "ASTUtils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+
+// The statement and every statement nested in it
+static void forEachStatement(const StmtPtr& stmt, const std::function<void(const StmtPtr&)>& fn) {
+    fn(stmt);
+    ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+        for (const auto& s : nested) {
+            forEachStatement(s, fn);
+        }
+    });
+}
+
+static bool isIntLiteral(const ExprPtr& expr, int value) {
+    auto literal = std::dynamic_pointer_cast<Literal>(expr);
+    return literal && std::holds_alternative<int>(literal->value) && std::get<int>(literal->value) == value;
+}
+
+// xs[0] or xs[xs.length() - 1]
+static bool isEndIndex(const ExprPtr& index, const std::string& name) {
+    if (isIntLiteral(index, 0)) return true;
+    auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(index);
+    if (!binaryOp || binaryOp->op != BinaryOp::Operator::SUB || !isIntLiteral(binaryOp->right, 1)) return false;
+    auto call = std::dynamic_pointer_cast<FunctionCall>(binaryOp->left);
+    auto member = call ? std::dynamic_pointer_cast<MemberAccess>(call->callee) : nullptr;
+    auto object = member ? std::dynamic_pointer_cast<Identifier>(member->object) : nullptr;
+    return object && object->name == name && member->memberName == "length";
+}
+
+// Iterations of a `for` loop with constant bounds and step, or -1
+static long long constantTrips(const std::shared_ptr<For>& loop) {
+    auto constant = [](const ExprPtr& expr) -> std::optional<long long> {
+        if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+            if (std::holds_alternative<int>(literal->value)) return std::get<int>(literal->value);
+        } else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+            auto literal = std::dynamic_pointer_cast<Literal>(unaryOp->operand);
+            if (unaryOp->op == UnaryOp::Operator::MINUS && literal && std::holds_alternative<int>(literal->value)) {
+                return -static_cast<long long>(std::get<int>(literal->value));
+            }
+        }
+        return std::nullopt;
+    };
+    auto start = constant(loop->start);
+    auto end = constant(loop->end);
+    auto step = loop->step ? constant(loop->step) : std::optional<long long>(1);
+    if (!start || !end || !step || *step <= 0) return -1;
+    return (std::llabs(*end - *start) + *step - 1) / *step;
+}
+
+void ContainerSelection::run(const std::shared_ptr<Program>& program) {
+    std::unordered_set<std::string> globals;
+    for (const auto& stmt : program->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) globals.insert(varDecl->name);
+    }
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            selectContainers(func, globals);
+            reserveAppends(func->body);
+        }
+    }
+}
+
+int ContainerSelection::getArrayCount() const {
+    return arrayCount;
+}
+
+int ContainerSelection::getSmallCount() const {
+    return smallCount;
+}
+
+int ContainerSelection::getDequeCount() const {
+    return dequeCount;
+}
+
+int ContainerSelection::getReservedCount() const {
+    return reservedCount;
+}
+
+void ContainerSelection::selectContainers(const std::shared_ptr<Function>& func,
+                                          const std::unordered_set<std::string>& globals) {
+    // Lists declared once in the function, from a list literal, that no
+    // global shares a name with: every use of the name is then that list
+    std::unordered_map<std::string, int> declarations;
+    std::unordered_map<std::string, std::shared_ptr<VarDecl>> lists;
+    for (const auto& param : func->parameters) {
+        ++declarations[param.second];
+    }
+    for (const auto& stmt : func->body) {
+        forEachStatement(stmt, [&](const StmtPtr& s) {
+            if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(s)) {
+                ++declarations[varDecl->name];
+                auto literal = std::dynamic_pointer_cast<Literal>(varDecl->initializer);
+                if (varDecl->type && varDecl->type->kind == Type::Kind::LIST && literal &&
+                    std::holds_alternative<std::vector<ExprPtr>>(literal->value) && !globals.count(varDecl->name)) {
+                    lists[varDecl->name] = varDecl;
+                }
+            } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(s)) {
+                ++declarations[tryCatch->exceptionName];
+            } else if (auto forStmt = std::dynamic_pointer_cast<For>(s)) {
+                ++declarations[forStmt->iterator];
+            }
+        });
+    }
+    Usages usages;
+    for (const auto& [name, varDecl] : lists) {
+        if (declarations[name] == 1) usages[name];
+    }
+    if (usages.empty()) return;
+
+    for (const auto& stmt : func->body) {
+        forEachStatement(stmt, [&](const StmtPtr& s) {
+            ASTUtils::forEachStatementExpression(s, [&](ExprPtr& expr) { collectUsage(expr, usages); });
+        });
+    }
+    for (const auto& [name, usage] : usages) {
+        if (usage.escapes) continue;
+        const auto& varDecl = lists[name];
+        auto initial = static_cast<long long>(
+            std::get<std::vector<ExprPtr>>(std::dynamic_pointer_cast<Literal>(varDecl->initializer)->value).size());
+        auto elementKind = varDecl->type->elementType ? varDecl->type->elementType->kind : Type::Kind::VOID;
+        bool scalar = elementKind == Type::Kind::INT || elementKind == Type::Kind::FLOAT ||
+                      elementKind == Type::Kind::BOOL;
+        // std::array takes its elements without nested braces only when
+        // they are not themselves aggregates initialized from a list
+        if (!usage.resized && initial <= kInlineLimit && (scalar || elementKind == Type::Kind::STRING)) {
+            varDecl->container = VarDecl::Container::Array;
+            varDecl->capacity = static_cast<int>(initial);
+            ++arrayCount;
+        } else if (long long bound = initial + appendBound(func->body, varDecl, 1, false);
+                   scalar && bound <= kInlineLimit) {
+            varDecl->container = VarDecl::Container::SmallVector;
+            varDecl->capacity = static_cast<int>(bound);
+            ++smallCount;
+        } else if (usage.front) {
+            varDecl->container = usage.indexed ? VarDecl::Container::DequeCppOnly : VarDecl::Container::Deque;
+            ++dequeCount;
+        }
+    }
+}
+
+void ContainerSelection::collectUsage(const ExprPtr& expr, Usages& usages) {
+    if (!expr) return;
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        // Anywhere but as the object of a method call or an indexing, the
+        // list is read as a whole
+        auto it = usages.find(ident->name);
+        if (it != usages.end()) it->second.escapes = true;
+        return;
+    }
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+        auto object = member ? std::dynamic_pointer_cast<Identifier>(member->object) : nullptr;
+        auto it = object ? usages.find(object->name) : usages.end();
+        if (it != usages.end()) {
+            const std::string& method = member->memberName;
+            if (method == "prepend" ||
+                (method == "remove" && !call->arguments.empty() && isIntLiteral(call->arguments[0], 0))) {
+                it->second.front = true;
+            } else if (method != "append" && method != "remove" && method != "length" && method != "empty") {
+                it->second.escapes = true;
+            }
+            if (method != "length") it->second.resized = true;
+            for (const auto& arg : call->arguments) {
+                collectUsage(arg, usages);
+            }
+            return;
+        }
+    } else if (auto access = std::dynamic_pointer_cast<ListAccess>(expr)) {
+        auto list = std::dynamic_pointer_cast<Identifier>(access->list);
+        auto it = list ? usages.find(list->name) : usages.end();
+        if (it != usages.end()) {
+            if (!isEndIndex(access->index, list->name)) it->second.indexed = true;
+            collectUsage(access->index, usages);
+            return;
+        }
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { collectUsage(sub, usages); });
+}
+
+long long ContainerSelection::appendBound(const std::vector<StmtPtr>& block, const std::shared_ptr<VarDecl>& decl,
+                                          long long repeats, bool declared) {
+    // repeats is how many times the block can run per run of the
+    // declaration; loops around the declaration create a new list each time
+    long long total = 0;
+    for (const auto& stmt : block) {
+        if (stmt == decl) {
+            declared = true;
+            repeats = 1;
+        }
+        auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt);
+        auto call = exprStmt ? std::dynamic_pointer_cast<FunctionCall>(exprStmt->expression) : nullptr;
+        auto member = call ? std::dynamic_pointer_cast<MemberAccess>(call->callee) : nullptr;
+        auto object = member ? std::dynamic_pointer_cast<Identifier>(member->object) : nullptr;
+        if (declared && object && object->name == decl->name &&
+            (member->memberName == "append" || member->memberName == "prepend")) {
+            total += repeats;
+        }
+        long long inner = repeats;
+        if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            long long trips = constantTrips(forStmt);
+            inner = trips < 0 ? kInlineLimit + 1 : std::min(repeats * trips, kInlineLimit + 1);
+        } else if (std::dynamic_pointer_cast<While>(stmt)) {
+            inner = kInlineLimit + 1;
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            total += appendBound(nested, decl, inner, declared);
+        });
+        total = std::min(total, kInlineLimit + 1);
+    }
+    return total;
+}
+
+void ContainerSelection::reserveAppends(std::vector<StmtPtr>& block) {
+    // Only lists declared earlier in the same block: one declared further out
+    // could be appended to by an enclosing loop as well, and reserving exact
+    // room on each of its iterations would copy the list every time
+    std::vector<std::shared_ptr<VarDecl>> lists;
+    for (const auto& stmt : block) {
+        auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+        if (varDecl && varDecl->type && varDecl->type->kind == Type::Kind::LIST &&
+            varDecl->container == VarDecl::Container::List) {
+            lists.push_back(varDecl);
+        }
+        // The C++ backend counts the iterations of loops with no step or a
+        // positive constant one
+        auto forStmt = std::dynamic_pointer_cast<For>(stmt);
+        auto step = forStmt ? std::dynamic_pointer_cast<Literal>(forStmt->step) : nullptr;
+        if (forStmt && !forStmt->parallel &&
+            (!forStmt->step || (step && std::holds_alternative<int>(step->value) && std::get<int>(step->value) > 0))) {
+            for (const auto& list : lists) {
+                if (list->name != forStmt->iterator && appendsEveryIteration(forStmt, list->name)) {
+                    forStmt->reservedLists.push_back(list->name);
+                    ++reservedCount;
+                }
+            }
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { reserveAppends(nested); });
+    }
+}
+
+bool ContainerSelection::appendsEveryIteration(const std::shared_ptr<For>& loop, const std::string& name) {
+    bool appends = false;
+    for (const auto& stmt : loop->body) {
+        auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt);
+        auto call = exprStmt ? std::dynamic_pointer_cast<FunctionCall>(exprStmt->expression) : nullptr;
+        auto member = call ? std::dynamic_pointer_cast<MemberAccess>(call->callee) : nullptr;
+        auto object = member ? std::dynamic_pointer_cast<Identifier>(member->object) : nullptr;
+        if (object && object->name == name && member->memberName == "append") {
+            appends = true;
+        }
+    }
+    // Reserving for iterations that endloop, next or return skip could
+    // allocate far more than the loop ever appends
+    bool reachable = true;
+    for (const auto& stmt : loop->body) {
+        forEachStatement(stmt, [&](const StmtPtr& s) {
+            auto varDecl = std::dynamic_pointer_cast<VarDecl>(s);
+            auto tryCatch = std::dynamic_pointer_cast<TryCatch>(s);
+            if (std::dynamic_pointer_cast<ENDLOOP>(s) || std::dynamic_pointer_cast<NEXT>(s) ||
+                std::dynamic_pointer_cast<Return>(s) || (varDecl && varDecl->name == name) ||
+                (tryCatch && tryCatch->exceptionName == name)) {
+                reachable = false;
+            }
+        });
+    }
+    return appends && reachable;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Picks the container behind local lists from how each function uses them.
+// This applies to lists only ever used through their own methods and
+// indexing, never copied, passed or returned:
+// - one of scalars or strings, never resized, that holds at most
+//   kInlineLimit elements is a std::array in C++, and one of scalars that
+//   can never grow past that
+//   (its appends sit in `for` loops with constant bounds) an
+//   hl::small_vector, so neither allocates;
+// - otherwise, one that is prepended to or has its first element removed
+//   is a queue, stored in a deque where both are constant time instead of
+//   shifting every element. Python keeps a plain list when the queue is
+//   also indexed away from its ends, which its deque does in linear time.
+// A list a `for` loop appends to once per iteration stays a vector, and
+// C++ reserves room for all of the loop's appends before it starts.
+class ContainerSelection {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    int getArrayCount() const;
+    int getSmallCount() const;
+    int getDequeCount() const;
+    int getReservedCount() const;
+
+    static constexpr long long kInlineLimit = 16;
+
+private:
+    struct Usage {
+        bool escapes = false;
+        bool front = false;
+        bool indexed = false;
+        bool resized = false;
+    };
+    using Usages = std::unordered_map<std::string, Usage>;
+
+    int arrayCount = 0;
+    int smallCount = 0;
+    int dequeCount = 0;
+    int reservedCount = 0;
+
+    void selectContainers(const std::shared_ptr<Function>& func, const std::unordered_set<std::string>& globals);
+    void reserveAppends(std::vector<StmtPtr>& block);
+    // Records how expr uses each of the candidate lists
+    static void collectUsage(const ExprPtr& expr, Usages& usages);
+    // Most elements appended or prepended to the list declared by decl, from
+    // its declaration on, capped at kInlineLimit + 1
+    static long long appendBound(const std::vector<StmtPtr>& block, const std::shared_ptr<VarDecl>& decl,
+                                 long long repeats, bool declared);
+    // True if the loop body appends to name at its top level, and nothing in
+    // it can skip that append or make it refer to another list
+    static bool appendsEveryIteration(const std::shared_ptr<For>& loop, const std::string& name);
+};
@@ -0,0 +1,329 @@
+#include "CopyElimination.h"
+#include "ASTUtils.h"
+#include <functional>
+
+void CopyElimination::run(const std::shared_ptr<Program>& program) {
+    effects = std::make_unique<EffectAnalysis>(program);
+    functions.clear();
+    globalNames.clear();
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            functions[func->name] = func;
+        } else if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            globalNames.insert(varDecl->name);
+        }
+    }
+
+    for (const auto& stmt : program->statements) {
+        auto func = std::dynamic_pointer_cast<Function>(stmt);
+        if (!func) continue;
+
+        // A name declared more than once may refer to different variables
+        std::unordered_map<std::string, int> declared;
+        Names listsAndStrings;
+        for (size_t i = 0; i < func->parameters.size(); ++i) {
+            const auto& [type, paramName] = func->parameters[i];
+            ++declared[paramName];
+            bool constRef = i < func->constRefParams.size() && func->constRefParams[i];
+            if (isListOrString(type) && !constRef) listsAndStrings.insert(paramName);
+        }
+        collectDeclared(func->body, declared, listsAndStrings);
+
+        movable.clear();
+        for (const auto& var : listsAndStrings) {
+            if (declared[var] == 1) movable.insert(var);
+        }
+        loopLive.clear();
+        tryLive.clear();
+        analyzeBlock(func->body, Names());
+
+        Names modified;
+        collectModified(func->body, modified);
+        params.clear();
+        for (const auto& param : func->parameters) {
+            params.insert(param.second);
+        }
+        bindReferences(func->body, modified, declared);
+    }
+
+    markAppends(program->statements);
+}
+
+int CopyElimination::getMovedCount() const {
+    return movedCount;
+}
+
+int CopyElimination::getBoundCount() const {
+    return boundCount;
+}
+
+int CopyElimination::getAppendCount() const {
+    return appendCount;
+}
+
+CopyElimination::Names CopyElimination::analyzeBlock(std::vector<StmtPtr>& block, Names live) {
+    for (auto it = block.rbegin(); it != block.rend(); ++it) {
+        live.insert(tryLive.begin(), tryLive.end());
+        live = analyzeStatement(*it, live);
+    }
+    return live;
+}
+
+CopyElimination::Names CopyElimination::analyzeStatement(const StmtPtr& stmt, const Names& liveOut) {
+    if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+        Names liveIn = analyzeBlock(ifStmt->thenBlock, liveOut);
+        for (auto& elif : ifStmt->elifBlocks) {
+            Names branch = analyzeBlock(elif.second, liveOut);
+            liveIn.insert(branch.begin(), branch.end());
+        }
+        Names elseIn = analyzeBlock(ifStmt->elseBlock, liveOut);
+        liveIn.insert(elseIn.begin(), elseIn.end());
+
+        ASTUtils::collectReads(ifStmt->condition, liveIn);
+        for (const auto& elif : ifStmt->elifBlocks) {
+            ASTUtils::collectReads(elif.first, liveIn);
+        }
+        return liveIn;
+    }
+
+    if (std::dynamic_pointer_cast<While>(stmt) || std::dynamic_pointer_cast<For>(stmt)) {
+        // Anything the loop reads may be read again on the next iteration,
+        // except variables declared afresh inside it
+        Names carried = liveOut;
+        std::unordered_map<std::string, int> declaredInside;
+        Names unused;
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& body) { collectDeclared(body, declaredInside, unused); });
+        for (const auto& name : statementReads(stmt)) {
+            if (!declaredInside.count(name)) carried.insert(name);
+        }
+
+        loopLive.push_back(carried);
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& body) { analyzeBlock(body, carried); });
+        loopLive.pop_back();
+        return carried;
+    }
+
+    if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+        // The catch block can start after any statement of the try block
+        Names catchIn = analyzeBlock(tryCatch->catchBlock, liveOut);
+        Names saved = tryLive;
+        tryLive.insert(catchIn.begin(), catchIn.end());
+        Names liveIn = analyzeBlock(tryCatch->tryBlock, liveOut);
+        tryLive = saved;
+        liveIn.insert(catchIn.begin(), catchIn.end());
+        return liveIn;
+    }
+
+    if (std::dynamic_pointer_cast<ENDLOOP>(stmt) || std::dynamic_pointer_cast<NEXT>(stmt)) {
+        return loopLive.empty() ? liveOut : loopLive.back();
+    }
+
+    if (std::dynamic_pointer_cast<Return>(stmt)) {
+        // Returning a local by name is already a move in C++
+        Names liveIn = statementReads(stmt);
+        liveIn.insert(tryLive.begin(), tryLive.end());
+        return liveIn;
+    }
+
+    markMoves(stmt, liveOut);
+
+    Names liveIn = liveOut;
+    if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+        liveIn.erase(varDecl->name);
+    } else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
+        auto assignment = std::dynamic_pointer_cast<Assignment>(exprStmt->expression);
+        auto target = assignment ? std::dynamic_pointer_cast<Identifier>(assignment->target) : nullptr;
+        if (target) liveIn.erase(target->name);
+    }
+    Names reads = statementReads(stmt);
+    liveIn.insert(reads.begin(), reads.end());
+    return liveIn;
+}
+
+void CopyElimination::markMoves(const StmtPtr& stmt, const Names& liveOut) {
+    if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+        markMove(varDecl->initializer, stmt, liveOut);
+    } else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
+        auto assignment = std::dynamic_pointer_cast<Assignment>(exprStmt->expression);
+        auto value = assignment ? std::dynamic_pointer_cast<Identifier>(assignment->value) : nullptr;
+        if (value && value->name != ASTUtils::rootVariable(assignment->target)) {
+            markMove(value, stmt, liveOut);
+        }
+    }
+
+    // Arguments that the callee takes by value, and elements stored into a list
+    std::function<void(const ExprPtr&)> visit = [&](const ExprPtr& expr) {
+        if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+            if (member && (member->memberName == "append" || member->memberName == "prepend") &&
+                !call->arguments.empty()) {
+                markMove(call->arguments.back(), stmt, liveOut);
+            }
+            auto callee = functions.find(ASTUtils::calledFunctionName(call));
+            if (callee != functions.end()) {
+                const auto& func = callee->second;
+                for (size_t i = 0; i < call->arguments.size() && i < func->parameters.size(); ++i) {
+                    bool constRef = i < func->constRefParams.size() && func->constRefParams[i];
+                    if (!constRef && isListOrString(func->parameters[i].first)) {
+                        markMove(call->arguments[i], stmt, liveOut);
+                    }
+                }
+            }
+        }
+        ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { visit(sub); });
+    };
+    ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { visit(expr); });
+}
+
+void CopyElimination::markMove(const ExprPtr& expr, const StmtPtr& stmt, const Names& liveOut) {
+    auto ident = std::dynamic_pointer_cast<Identifier>(expr);
+    if (!ident || ident->lastUse || !movable.count(ident->name) || liveOut.count(ident->name)) return;
+
+    // Any other read in the same statement could see the moved-from value
+    int reads = 0;
+    ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& e) { reads += countReads(e, ident->name); });
+    if (reads != 1) return;
+
+    ident->lastUse = true;
+    ++movedCount;
+}
+
+void CopyElimination::bindReferences(std::vector<StmtPtr>& block, const Names& modified,
+                                     const std::unordered_map<std::string, int>& declared) {
+    for (size_t k = 0; k < block.size(); ++k) {
+        const StmtPtr& stmt = block[k];
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { bindReferences(nested, modified, declared); });
+
+        auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+        if (!varDecl || !varDecl->initializer || !isListOrString(varDecl->type)) continue;
+        auto count = declared.find(varDecl->name);
+        if (count == declared.end() || count->second != 1 || modified.count(varDecl->name)) continue;
+
+        // Only whole variables and elements of lists, never a temporary value
+        ExprPtr source = varDecl->initializer;
+        while (auto element = std::dynamic_pointer_cast<ListAccess>(source)) {
+            if (!element->list->type || element->list->type->kind != Type::Kind::LIST) break;
+            source = element->list;
+        }
+        auto root = std::dynamic_pointer_cast<Identifier>(source);
+        if (!root || root->lastUse || ASTUtils::rootVariable(varDecl->initializer) != root->name) continue;
+
+        std::vector<StmtPtr> rest(block.begin() + static_cast<long>(k) + 1, block.end());
+        if (changesIn(rest, root->name)) continue;
+
+        varDecl->bindReference = true;
+        ++boundCount;
+    }
+}
+
+bool CopyElimination::changesIn(const std::vector<StmtPtr>& stmts, const std::string& name) const {
+    // Globals can also change inside called functions, unless a parameter hides them
+    bool global = globalNames.count(name) && !params.count(name);
+    bool changed = false;
+    std::function<void(const ExprPtr&)> visit = [&](const ExprPtr& expr) {
+        if (!expr || changed) return;
+        if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+            changed = ident->name == name && ident->lastUse;
+            return;
+        }
+        Names written;
+        ASTUtils::collectWrittenVariables(expr, written);
+        if (written.count(name)) {
+            changed = true;
+            return;
+        }
+        std::string callee = ASTUtils::calledFunctionName(expr);
+        if (global && !callee.empty() && effects->effectsOf(callee).writtenGlobals.count(name)) {
+            changed = true;
+            return;
+        }
+        ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { visit(sub); });
+    };
+
+    for (const auto& stmt : stmts) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { visit(expr); });
+        std::vector<StmtPtr> nestedStmts;
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            nestedStmts.insert(nestedStmts.end(), nested.begin(), nested.end());
+        });
+        if (changed || (!nestedStmts.empty() && changesIn(nestedStmts, name))) return true;
+    }
+    return false;
+}
+
+void CopyElimination::markAppends(std::vector<StmtPtr>& block) {
+    std::function<void(const ExprPtr&)> visit = [&](const ExprPtr& expr) {
+        if (!expr) return;
+        ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { visit(sub); });
+
+        auto assignment = std::dynamic_pointer_cast<Assignment>(expr);
+        if (assignment && !ASTUtils::stringAppendParts(assignment).empty()) {
+            assignment->appendInPlace = true;
+            ++appendCount;
+        }
+    };
+
+    for (const auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { visit(expr); });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { markAppends(nested); });
+    }
+}
+
+CopyElimination::Names CopyElimination::statementReads(const StmtPtr& stmt) {
+    Names reads;
+    ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { ASTUtils::collectReads(expr, reads); });
+    ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+        for (const auto& s : nested) {
+            Names inner = statementReads(s);
+            reads.insert(inner.begin(), inner.end());
+        }
+    });
+    return reads;
+}
+
+void CopyElimination::collectDeclared(const std::vector<StmtPtr>& block, std::unordered_map<std::string, int>& counts,
+                                      Names& listsAndStrings) {
+    for (const auto& stmt : block) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            ++counts[varDecl->name];
+            if (isListOrString(varDecl->type)) listsAndStrings.insert(varDecl->name);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            ++counts[forStmt->iterator];
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            ++counts[tryCatch->exceptionName];
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            collectDeclared(nested, counts, listsAndStrings);
+        });
+    }
+}
+
+void CopyElimination::collectModified(const std::vector<StmtPtr>& block, Names& names) {
+    for (const auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+            ASTUtils::collectWrittenVariables(expr, names);
+        });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { collectModified(nested, names); });
+    }
+}
+
+int CopyElimination::countReads(const ExprPtr& expr, const std::string& name) {
+    if (!expr) return 0;
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        return ident->name == name ? 1 : 0;
+    }
+    int count = 0;
+    if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        // A plain `x = ...` does not read x
+        if (!std::dynamic_pointer_cast<Identifier>(assignment->target)) {
+            count += countReads(assignment->target, name);
+        }
+        return count + countReads(assignment->value, name);
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { count += countReads(sub, name); });
+    return count;
+}
+
+bool CopyElimination::isListOrString(const TypePtr& type) {
+    return type && (type->kind == Type::Kind::LIST || type->kind == Type::Kind::MATRIX || type->kind == Type::Kind::STRING);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+#include "EffectAnalysis.h"
+
+// Removes list and string copies from the generated C++:
+//  - a local list or string that is dead after being assigned, stored or
+//    passed by value is moved instead (liveness is computed backwards over
+//    each function body; a loop keeps everything it reads alive)
+//  - a local initialized from a variable or list element is bound by const
+//    reference when neither changes while the local is in scope
+//  - `s = s + a + b` on strings appends to s in place
+class CopyElimination {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    int getMovedCount() const;
+    int getBoundCount() const;
+    int getAppendCount() const;
+
+private:
+    using Names = std::unordered_set<std::string>;
+
+    std::unique_ptr<EffectAnalysis> effects;
+    std::unordered_map<std::string, std::shared_ptr<Function>> functions;
+    std::unordered_set<std::string> globalNames;
+
+    // Per function: list/string variables that are safe to move from
+    Names movable;
+    Names params;
+    // Live sets at `endloop`/`next` of the enclosing loops
+    std::vector<Names> loopLive;
+    // Variables a catch block may still read while its try block runs
+    Names tryLive;
+
+    int movedCount = 0;
+    int boundCount = 0;
+    int appendCount = 0;
+
+    Names analyzeBlock(std::vector<StmtPtr>& block, Names live);
+    Names analyzeStatement(const StmtPtr& stmt, const Names& liveOut);
+    void markMoves(const StmtPtr& stmt, const Names& liveOut);
+    void markMove(const ExprPtr& expr, const StmtPtr& stmt, const Names& liveOut);
+
+    void bindReferences(std::vector<StmtPtr>& block, const Names& modified,
+                        const std::unordered_map<std::string, int>& declared);
+    bool changesIn(const std::vector<StmtPtr>& stmts, const std::string& name) const;
+    void markAppends(std::vector<StmtPtr>& block);
+
+    static Names statementReads(const StmtPtr& stmt);
+    static void collectDeclared(const std::vector<StmtPtr>& block, std::unordered_map<std::string, int>& counts,
+                                Names& listsAndStrings);
+    static void collectModified(const std::vector<StmtPtr>& block, Names& names);
+    static int countReads(const ExprPtr& expr, const std::string& name);
+    static bool isListOrString(const TypePtr& type);
+};
@@ -0,0 +1,148 @@
+#include "DeadCodeEliminator.h"
+#include "ASTUtils.h"
+#include "CallGraph.h"
+
+void DeadCodeEliminator::run(const std::shared_ptr<Program>& program) {
+    globalNames.clear();
+    for (const auto& stmt : program->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            globalNames.insert(varDecl->name);
+        }
+    }
+
+    removeUnusedFunctions(program);
+
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            removeUnreachableStatements(func->body);
+            removeDeadStores(func);
+        }
+    }
+    removeUnreachableStatements(program->statements);
+}
+
+const std::vector<std::string>& DeadCodeEliminator::getRemovedFunctions() const {
+    return removedFunctions;
+}
+
+void DeadCodeEliminator::removeUnusedFunctions(const std::shared_ptr<Program>& program) {
+    CallGraph callGraph(program);
+    std::unordered_set<std::string> reachable = callGraph.reachableFunctions();
+
+    std::vector<StmtPtr> kept;
+    for (const auto& stmt : program->statements) {
+        if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            if (!reachable.count(func->name)) {
+                removedFunctions.push_back(func->name);
+                continue;
+            }
+        }
+        kept.push_back(stmt);
+    }
+    program->statements = std::move(kept);
+}
+
+void DeadCodeEliminator::removeUnreachableStatements(std::vector<StmtPtr>& block) {
+    for (size_t i = 0; i < block.size(); ++i) {
+        ASTUtils::forEachBlock(block[i], [&](std::vector<StmtPtr>& nested) {
+            removeUnreachableStatements(nested);
+        });
+
+        // Everything after an unconditional jump in the same block is dead
+        if (std::dynamic_pointer_cast<Return>(block[i]) ||
+            std::dynamic_pointer_cast<ENDLOOP>(block[i]) ||
+            std::dynamic_pointer_cast<NEXT>(block[i])) {
+            block.resize(i + 1);
+            return;
+        }
+    }
+}
+
+void DeadCodeEliminator::removeDeadStores(const std::shared_ptr<Function>& function) {
+    std::unordered_set<std::string> params;
+    for (const auto& param : function->parameters) {
+        params.insert(param.second);
+    }
+
+    bool changed = true;
+    while (changed) {
+        std::unordered_set<std::string> locals;
+        std::unordered_set<std::string> reads;
+        collectLocals(function->body, locals);
+        collectReads(function->body, reads);
+
+        std::unordered_set<std::string> deadLocals;
+        for (const auto& name : locals) {
+            // Names shadowing a global or a parameter are left alone
+            if (!reads.count(name) && !params.count(name) && !globalNames.count(name)) {
+                deadLocals.insert(name);
+            }
+        }
+        changed = !deadLocals.empty() && removeStoresTo(function->body, deadLocals);
+    }
+}
+
+bool DeadCodeEliminator::removeStoresTo(std::vector<StmtPtr>& block,
+                                        const std::unordered_set<std::string>& deadLocals) {
+    bool changed = false;
+    std::vector<StmtPtr> kept;
+
+    for (const auto& stmt : block) {
+        ExprPtr storedValue;
+        bool isDeadStore = false;
+
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            if (deadLocals.count(varDecl->name)) {
+                isDeadStore = true;
+                storedValue = varDecl->initializer;
+            }
+        } else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
+            if (auto assign = std::dynamic_pointer_cast<Assignment>(exprStmt->expression)) {
+                auto target = std::dynamic_pointer_cast<Identifier>(assign->target);
+                if (target && deadLocals.count(target->name)) {
+                    isDeadStore = true;
+                    storedValue = assign->value;
+                }
+            }
+        }
+
+        if (isDeadStore) {
+            changed = true;
+            // Keep the evaluation of the stored value if it is observable
+            if (storedValue && (ASTUtils::hasSideEffects(storedValue) || ASTUtils::mayTrap(storedValue))) {
+                kept.push_back(std::make_shared<ExpressionStatement>(storedValue));
+            }
+            continue;
+        }
+
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            if (removeStoresTo(nested, deadLocals)) changed = true;
+        });
+        kept.push_back(stmt);
+    }
+
+    block = std::move(kept);
+    return changed;
+}
+
+void DeadCodeEliminator::collectLocals(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& locals) {
+    for (const auto& stmt : block) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            locals.insert(varDecl->name);
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            collectLocals(nested, locals);
+        });
+    }
+}
+
+void DeadCodeEliminator::collectReads(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& reads) {
+    for (const auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+            ASTUtils::collectReads(expr, reads);
+        });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            collectReads(nested, reads);
+        });
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Removes functions that are never called from the top-level program,
+// statements that follow a `return`, `endloop` or `next` in the same block,
+// and stores to function locals that are never read.
+class DeadCodeEliminator {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    const std::vector<std::string>& getRemovedFunctions() const;
+
+private:
+    std::vector<std::string> removedFunctions;
+    std::unordered_set<std::string> globalNames;
+
+    void removeUnusedFunctions(const std::shared_ptr<Program>& program);
+    void removeUnreachableStatements(std::vector<StmtPtr>& block);
+    void removeDeadStores(const std::shared_ptr<Function>& function);
+    bool removeStoresTo(std::vector<StmtPtr>& block, const std::unordered_set<std::string>& deadLocals);
+
+    void collectLocals(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& locals);
+    void collectReads(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& reads);
+};
@@ -0,0 +1,224 @@
+#include "EffectAnalysis.h"
+#include "ASTUtils.h"
+
+static bool isListLiteral(const ExprPtr& expr) {
+    auto literal = std::dynamic_pointer_cast<Literal>(expr);
+    return literal && std::holds_alternative<std::vector<ExprPtr>>(literal->value);
+}
+
+// Lists and matrices are shared by reference in Python
+static bool isContainer(const TypePtr& type) {
+    return type && (type->kind == Type::Kind::LIST || type->kind == Type::Kind::MATRIX);
+}
+
+EffectAnalysis::EffectAnalysis(const std::shared_ptr<Program>& program) {
+    for (const auto& stmt : program->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            globalTypes[varDecl->name] = varDecl->type;
+        } else if (auto func = std::dynamic_pointer_cast<Function>(stmt)) {
+            functions[func->name] = func;
+        }
+    }
+
+    // Direct effects of each function body
+    std::unordered_map<std::string, Scope> scopes;
+    for (const auto& [name, func] : functions) {
+        Scope& scope = scopes[name];
+        for (size_t i = 0; i < func->parameters.size(); ++i) {
+            scope.params[func->parameters[i].second] = i;
+            scope.variableTypes[func->parameters[i].second] = func->parameters[i].first;
+        }
+        FunctionEffects& result = effects[name];
+        scanBlock(func->body, scope, result);
+    }
+
+    // Fold in the effects of callees until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& [name, func] : functions) {
+            Scope& scope = scopes[name];
+            FunctionEffects& result = effects[name];
+            size_t before = result.readGlobals.size() + result.writtenGlobals.size() +
+                            result.mutatedParams.size() + (result.performsIO ? 1 : 0) + (result.mayTrap ? 1 : 0);
+
+            for (const auto& call : scope.calls) {
+                std::string calleeName = ASTUtils::calledFunctionName(call);
+                if (!functions.count(calleeName)) continue;
+                const FunctionEffects& callee = effects[calleeName];
+
+                result.performsIO = result.performsIO || callee.performsIO;
+                result.mayTrap = result.mayTrap || callee.mayTrap;
+                result.readGlobals.insert(callee.readGlobals.begin(), callee.readGlobals.end());
+                result.writtenGlobals.insert(callee.writtenGlobals.begin(), callee.writtenGlobals.end());
+                for (size_t index : callee.mutatedParams) {
+                    if (index < call->arguments.size()) {
+                        noteWrite(call->arguments[index], false, scope, result);
+                    }
+                }
+            }
+
+            size_t after = result.readGlobals.size() + result.writtenGlobals.size() +
+                           result.mutatedParams.size() + (result.performsIO ? 1 : 0) + (result.mayTrap ? 1 : 0);
+            if (after != before) changed = true;
+        }
+    }
+}
+
+const FunctionEffects& EffectAnalysis::effectsOf(const std::string& name) const {
+    static const FunctionEffects none;
+    auto it = effects.find(name);
+    return it != effects.end() ? it->second : none;
+}
+
+bool EffectAnalysis::isPure(const std::string& name) const {
+    auto it = effects.find(name);
+    return it != effects.end() && it->second.writtenGlobals.empty() &&
+           it->second.mutatedParams.empty() && !it->second.performsIO;
+}
+
+void EffectAnalysis::scanBlock(const std::vector<StmtPtr>& block, Scope& scope, FunctionEffects& result) {
+    // Aliasing is decided per function, so collect it before resolving writes
+    std::vector<std::pair<ExprPtr, bool>> pendingWrites;
+
+    std::function<void(const std::vector<StmtPtr>&)> scan = [&](const std::vector<StmtPtr>& stmts) {
+        for (const auto& stmt : stmts) {
+            if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+                scope.locals.insert(varDecl->name);
+                scope.variableTypes[varDecl->name] = varDecl->type;
+                if (isContainer(varDecl->type) && varDecl->initializer &&
+                    !isListLiteral(varDecl->initializer)) {
+                    scope.aliasedLists.insert(varDecl->name);
+                }
+            } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+                scope.locals.insert(forStmt->iterator);
+            } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+                scope.locals.insert(tryCatch->exceptionName);
+            } else if (std::dynamic_pointer_cast<Print>(stmt) || std::dynamic_pointer_cast<Input>(stmt)) {
+                result.performsIO = true;
+            }
+
+            ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+                std::function<void(const ExprPtr&)> visit = [&](const ExprPtr& e) {
+                    if (!e) return;
+                    if (trapsAt(e)) {
+                        result.mayTrap = true;
+                    }
+                    if (auto ident = std::dynamic_pointer_cast<Identifier>(e)) {
+                        // Locals never reuse a global's name; parameters may
+                        if (globalTypes.count(ident->name) && !scope.params.count(ident->name)) {
+                            result.readGlobals.insert(ident->name);
+                        }
+                    } else if (auto assignment = std::dynamic_pointer_cast<Assignment>(e)) {
+                        bool rebinds = std::dynamic_pointer_cast<Identifier>(assignment->target) != nullptr;
+                        if (auto element = std::dynamic_pointer_cast<ListAccess>(assignment->target)) {
+                            pendingWrites.emplace_back(element->list, false);
+                        } else {
+                            pendingWrites.emplace_back(assignment->target, rebinds);
+                        }
+                        if (rebinds && assignment->value && assignment->value->type &&
+                            isContainer(assignment->value->type) && !isListLiteral(assignment->value)) {
+                            scope.aliasedLists.insert(ASTUtils::rootVariable(assignment->target));
+                        }
+                    } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(e)) {
+                        if (auto ident = std::dynamic_pointer_cast<Identifier>(call->callee)) {
+                            if (ASTUtils::isIOBuiltin(ident->name)) {
+                                result.performsIO = true;
+                            } else if (!ASTUtils::isBuiltinFunction(ident->name)) {
+                                scope.calls.push_back(call);
+                            }
+                        } else if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+                            if (ASTUtils::isMutatingListMethod(member->memberName)) {
+                                pendingWrites.emplace_back(member->object, false);
+                            }
+                        }
+                    }
+                    ASTUtils::forEachSubExpression(e, [&](ExprPtr& sub) { visit(sub); });
+                };
+                visit(expr);
+            });
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { scan(nested); });
+        }
+    };
+    scan(block);
+
+    for (const auto& [target, rebinds] : pendingWrites) {
+        noteWrite(target, rebinds, scope, result);
+    }
+}
+
+void EffectAnalysis::noteWrite(const ExprPtr& container, bool rebinds, const Scope& scope,
+                               FunctionEffects& result) {
+    std::string name = ASTUtils::rootVariable(container);
+    bool direct = std::dynamic_pointer_cast<Identifier>(container) != nullptr;
+
+    // Nested lists and lists returned by calls may be shared with any
+    // other list of the same type
+    if (!direct) {
+        noteAliasedWrite(container->type, scope, result);
+        if (name.empty()) return;
+    }
+
+    auto param = scope.params.find(name);
+    if (param != scope.params.end()) {
+        if (!rebinds) result.mutatedParams.insert(param->second);
+    } else if (!scope.locals.count(name) && globalTypes.count(name)) {
+        result.writtenGlobals.insert(name);
+        return;
+    }
+
+    // Writing through a list that may be shared with a caller's or a global list
+    if (direct && !rebinds && scope.aliasedLists.count(name)) {
+        auto type = scope.variableTypes.find(name);
+        if (type != scope.variableTypes.end()) {
+            noteAliasedWrite(type->second, scope, result);
+        }
+    }
+}
+
+void EffectAnalysis::noteAliasedWrite(const TypePtr& type, const Scope& scope, FunctionEffects& result) {
+    if (!isContainer(type)) return;
+    for (const auto& [name, index] : scope.params) {
+        auto paramType = scope.variableTypes.find(name);
+        if (paramType != scope.variableTypes.end() && typeContains(paramType->second, type)) {
+            result.mutatedParams.insert(index);
+        }
+    }
+    for (const auto& [name, globalType] : globalTypes) {
+        if (typeContains(globalType, type)) {
+            result.writtenGlobals.insert(name);
+        }
+    }
+}
+
+bool EffectAnalysis::trapsAt(const ExprPtr& expr) {
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        if ((binaryOp->op == BinaryOp::Operator::DIV || binaryOp->op == BinaryOp::Operator::MOD) &&
+            !binaryOp->nonZeroDivisor) {
+            auto literal = std::dynamic_pointer_cast<Literal>(binaryOp->right);
+            bool nonZero = literal && ((std::holds_alternative<int>(literal->value) && std::get<int>(literal->value)) ||
+                                       (std::holds_alternative<float>(literal->value) &&
+                                        std::get<float>(literal->value) != 0.0f));
+            return !nonZero;
+        }
+    } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        if (auto ident = std::dynamic_pointer_cast<Identifier>(call->callee)) {
+            // Only parsing a string can fail
+            bool parsesString = !call->arguments.empty() && call->arguments[0]->type &&
+                                call->arguments[0]->type->kind == Type::Kind::STRING;
+            return ((ident->name == "INT" || ident->name == "FLOAT") && parsesString) || ident->name == "zeros";
+        }
+        if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+            const std::string& name = member->memberName;
+            return name == "substring" || name == "toBinary" || name == "min" || name == "max" || name == "dot" ||
+                   name == "add" || name == "matmul";
+        }
+    }
+    return false;
+}
+
+bool EffectAnalysis::typeContains(const TypePtr& outer, const TypePtr& inner) {
+    if (!outer || !inner) return false;
+    if (ASTUtils::typeName(outer) == ASTUtils::typeName(inner)) return true;
+    return outer->kind == Type::Kind::LIST && typeContains(outer->elementType, inner);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+struct FunctionEffects {
+    // Globals the function may read
+    std::unordered_set<std::string> readGlobals;
+    // Globals the function may assign, resize or write elements of
+    std::unordered_set<std::string> writtenGlobals;
+    // Positions of list parameters whose contents the function may change
+    std::unordered_set<size_t> mutatedParams;
+    bool performsIO = false;
+    // The function may raise an error, directly or in a function it calls
+    bool mayTrap = false;
+};
+
+// Interprocedural summary of what each user function may modify, including
+// the effects of everything it calls. Lists are shared by reference in the
+// Python backend, so a local list copied from another variable is assumed
+// to alias every parameter or global that could hold a list of its type.
+class EffectAnalysis {
+public:
+    explicit EffectAnalysis(const std::shared_ptr<Program>& program);
+
+    const FunctionEffects& effectsOf(const std::string& name) const;
+
+    // True for user functions that write no globals, change none of their
+    // list arguments and do no I/O; their result depends only on the
+    // arguments and the globals they read.
+    bool isPure(const std::string& name) const;
+
+    // True if evaluating this node itself, not its operands, may raise an
+    // error in the generated C++: a division by a possible zero, parsing a
+    // string, or a builtin that checks its arguments. List indexing is
+    // unchecked there, and calls to user functions are covered by mayTrap.
+    static bool trapsAt(const ExprPtr& expr);
+
+    // True if a value of type `outer` can hold a value of type `inner`.
+    static bool typeContains(const TypePtr& outer, const TypePtr& inner);
+
+private:
+    struct Scope {
+        std::unordered_map<std::string, size_t> params;
+        std::unordered_set<std::string> locals;
+        std::unordered_set<std::string> aliasedLists;
+        std::unordered_map<std::string, TypePtr> variableTypes;
+        std::vector<std::shared_ptr<FunctionCall>> calls;
+    };
+
+    std::unordered_map<std::string, TypePtr> globalTypes;
+    std::unordered_map<std::string, std::shared_ptr<Function>> functions;
+    std::unordered_map<std::string, FunctionEffects> effects;
+
+    void scanBlock(const std::vector<StmtPtr>& block, Scope& scope, FunctionEffects& result);
+    void noteWrite(const ExprPtr& container, bool rebinds, const Scope& scope, FunctionEffects& result);
+    void noteAliasedWrite(const TypePtr& type, const Scope& scope, FunctionEffects& result);
+};
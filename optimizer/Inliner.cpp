@@ -0,0 +1,203 @@
+#include "Inliner.h"
+#include "ASTUtils.h"
+#include "CallGraph.h"
+#include <algorithm>
+
+Inliner::Inliner(int sizeThreshold) : sizeThreshold(sizeThreshold) {}
+
+void Inliner::run(const std::shared_ptr<Program>& program) {
+    candidates.clear();
+    inlinedFunctions.clear();
+    effects = std::make_unique<EffectAnalysis>(program);
+
+    CallGraph callGraph(program);
+    for (const auto& name : callGraph.bottomUpOrder()) {
+        auto func = callGraph.getFunction(name);
+
+        std::unordered_set<std::string> callerNames;
+        for (const auto& param : func->parameters) {
+            callerNames.insert(param.second);
+        }
+        collectDeclaredNames(func->body, callerNames);
+        inlineCalls(func->body, callerNames);
+
+        if (!callGraph.isRecursive(name) && isCandidate(func)) {
+            candidates[name] = func;
+        }
+    }
+
+    // Top-level declarations are globals the callees may read; only
+    // names introduced in nested top-level blocks can shadow them.
+    std::unordered_set<std::string> topLevelNames;
+    for (const auto& stmt : program->statements) {
+        if (std::dynamic_pointer_cast<Function>(stmt)) continue;
+        if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            topLevelNames.insert(forStmt->iterator);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            topLevelNames.insert(tryCatch->exceptionName);
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            collectDeclaredNames(nested, topLevelNames);
+        });
+    }
+
+    for (auto& stmt : program->statements) {
+        if (std::dynamic_pointer_cast<Function>(stmt)) continue;
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { inlineCalls(expr, topLevelNames); });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { inlineCalls(nested, topLevelNames); });
+    }
+}
+
+const std::vector<std::string>& Inliner::getInlinedFunctions() const {
+    return inlinedFunctions;
+}
+
+bool Inliner::isCandidate(const std::shared_ptr<Function>& func) const {
+    if (func->body.size() != 1) return false;
+    auto returnStmt = std::dynamic_pointer_cast<Return>(func->body[0]);
+    if (!returnStmt || !returnStmt->value) return false;
+
+    // Any remaining user call counts as a side effect, so only leaves qualify
+    return !ASTUtils::hasSideEffects(returnStmt->value) &&
+           ASTUtils::expressionSize(returnStmt->value) <= sizeThreshold;
+}
+
+void Inliner::inlineCalls(std::vector<StmtPtr>& block, const std::unordered_set<std::string>& callerNames) {
+    for (auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { inlineCalls(expr, callerNames); });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { inlineCalls(nested, callerNames); });
+    }
+}
+
+void Inliner::inlineCalls(ExprPtr& expr, const std::unordered_set<std::string>& callerNames) {
+    if (!expr) return;
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { inlineCalls(sub, callerNames); });
+
+    auto it = candidates.find(ASTUtils::calledFunctionName(expr));
+    if (it == candidates.end()) return;
+
+    auto call = std::static_pointer_cast<FunctionCall>(expr);
+    if (ExprPtr expanded = expandCall(call, it->second, callerNames)) {
+        expr = expanded;
+        if (std::find(inlinedFunctions.begin(), inlinedFunctions.end(), it->first) == inlinedFunctions.end()) {
+            inlinedFunctions.push_back(it->first);
+        }
+    }
+}
+
+ExprPtr Inliner::expandCall(const std::shared_ptr<FunctionCall>& call, const std::shared_ptr<Function>& callee,
+                            const std::unordered_set<std::string>& callerNames) const {
+    if (call->arguments.size() != callee->parameters.size()) return nullptr;
+    const ExprPtr& body = std::static_pointer_cast<Return>(callee->body[0])->value;
+
+    std::unordered_set<std::string> paramNames;
+    for (const auto& param : callee->parameters) {
+        paramNames.insert(param.second);
+    }
+
+    // Globals read by the callee must not be shadowed at the call site
+    std::unordered_set<std::string> freeNames;
+    ASTUtils::collectReads(body, freeNames);
+    for (const auto& name : freeNames) {
+        if (!paramNames.count(name) && callerNames.count(name)) return nullptr;
+    }
+
+    std::unordered_map<std::string, ExprPtr> bindings;
+    int effectfulArgs = 0;
+    for (size_t i = 0; i < call->arguments.size(); ++i) {
+        const ExprPtr& arg = call->arguments[i];
+        const auto& param = callee->parameters[i];
+
+        // Passing an int to a float parameter converts it; keep such calls
+        if (!arg->type || !param.first || arg->type->kind != param.first->kind) return nullptr;
+
+        int uses = 0;
+        int conditionalUses = 0;
+        countUses(body, param.second, false, uses, conditionalUses);
+
+        if (ASTUtils::hasSideEffects(arg) || ASTUtils::mayTrap(arg)) {
+            // The argument must still be evaluated exactly once, and before
+            // anything in the body that could fail
+            if (uses != 1 || conditionalUses != 0) return nullptr;
+            if (ASTUtils::hasSideEffects(arg) && ASTUtils::mayTrap(body)) return nullptr;
+            // The body may read a variable before it reaches the argument,
+            // while the call reads it after the argument changed it
+            std::unordered_set<std::string> written;
+            ASTUtils::collectWrittenVariables(arg, written);
+            collectCallWrites(arg, written);
+            for (const auto& name : written) {
+                if (freeNames.count(name) && !paramNames.count(name)) return nullptr;
+            }
+            ++effectfulArgs;
+        } else if (uses > 1 && ASTUtils::expressionSize(arg) > 3) {
+            return nullptr;
+        }
+        bindings[param.second] = arg;
+    }
+    if (effectfulArgs > 1) return nullptr;
+
+    return substitute(body, bindings);
+}
+
+void Inliner::collectCallWrites(const ExprPtr& expr, std::unordered_set<std::string>& names) const {
+    if (!expr) return;
+    std::string callee = ASTUtils::calledFunctionName(expr);
+    if (!callee.empty()) {
+        const FunctionEffects& calleeEffects = effects->effectsOf(callee);
+        names.insert(calleeEffects.writtenGlobals.begin(), calleeEffects.writtenGlobals.end());
+        const auto& arguments = std::static_pointer_cast<FunctionCall>(expr)->arguments;
+        for (size_t param : calleeEffects.mutatedParams) {
+            if (param < arguments.size()) names.insert(ASTUtils::rootVariable(arguments[param]));
+        }
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { collectCallWrites(sub, names); });
+}
+
+ExprPtr Inliner::substitute(const ExprPtr& expr, const std::unordered_map<std::string, ExprPtr>& bindings) {
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        auto it = bindings.find(ident->name);
+        if (it != bindings.end()) {
+            return ASTUtils::cloneExpression(it->second);
+        }
+    }
+    ExprPtr copy = ASTUtils::cloneExpression(expr);
+    ASTUtils::forEachSubExpression(copy, [&](ExprPtr& sub) { sub = substitute(sub, bindings); });
+    return copy;
+}
+
+void Inliner::countUses(const ExprPtr& expr, const std::string& name, bool conditional,
+                        int& uses, int& conditionalUses) {
+    if (!expr) return;
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        if (ident->name == name) {
+            ++uses;
+            if (conditional) ++conditionalUses;
+        }
+        return;
+    }
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        if (binaryOp->op == BinaryOp::Operator::AND || binaryOp->op == BinaryOp::Operator::OR) {
+            countUses(binaryOp->left, name, conditional, uses, conditionalUses);
+            countUses(binaryOp->right, name, true, uses, conditionalUses);
+            return;
+        }
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) {
+        countUses(sub, name, conditional, uses, conditionalUses);
+    });
+}
+
+void Inliner::collectDeclaredNames(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& names) {
+    for (const auto& stmt : block) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            names.insert(varDecl->name);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            names.insert(forStmt->iterator);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            names.insert(tryCatch->exceptionName);
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            collectDeclaredNames(nested, names);
+        });
+    }
+}
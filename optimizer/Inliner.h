@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+#include "EffectAnalysis.h"
+
+// Replaces calls to small non-recursive functions whose body is a single
+// `return <expr>` with that expression, parameters bound to the call's
+// arguments. Functions are processed callees-first so that a helper built
+// from other helpers can itself become inlinable.
+class Inliner {
+public:
+    explicit Inliner(int sizeThreshold);
+    void run(const std::shared_ptr<Program>& program);
+
+    // Functions whose calls were replaced, in the order they were first inlined.
+    const std::vector<std::string>& getInlinedFunctions() const;
+
+private:
+    int sizeThreshold;
+    std::unordered_map<std::string, std::shared_ptr<Function>> candidates;
+    std::vector<std::string> inlinedFunctions;
+    std::unique_ptr<EffectAnalysis> effects;
+
+    bool isCandidate(const std::shared_ptr<Function>& func) const;
+    void inlineCalls(std::vector<StmtPtr>& block, const std::unordered_set<std::string>& callerNames);
+    void inlineCalls(ExprPtr& expr, const std::unordered_set<std::string>& callerNames);
+    ExprPtr expandCall(const std::shared_ptr<FunctionCall>& call, const std::shared_ptr<Function>& callee,
+                       const std::unordered_set<std::string>& callerNames) const;
+
+    // Variables the user functions called in expr may assign or modify
+    void collectCallWrites(const ExprPtr& expr, std::unordered_set<std::string>& names) const;
+
+    static ExprPtr substitute(const ExprPtr& expr, const std::unordered_map<std::string, ExprPtr>& bindings);
+    static void countUses(const ExprPtr& expr, const std::string& name, bool conditional,
+                          int& uses, int& conditionalUses);
+    static void collectDeclaredNames(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& names);
+};
@@ -0,0 +1,230 @@
+#include "LoopInvariantCodeMotion.h"
+#include "ASTUtils.h"
+
+static const std::string TEMP_PREFIX = "__licm";
+
+void LoopInvariantCodeMotion::run(const std::shared_ptr<Program>& program) {
+    effects = std::make_unique<EffectAnalysis>(program);
+    optimizeBlock(program->statements, true);
+}
+
+int LoopInvariantCodeMotion::getHoistedCount() const {
+    return hoistedCount;
+}
+
+void LoopInvariantCodeMotion::optimizeBlock(std::vector<StmtPtr>& block, bool programLevel) {
+    std::vector<StmtPtr> result;
+    for (const auto& stmt : block) {
+        if (std::dynamic_pointer_cast<For>(stmt) || std::dynamic_pointer_cast<While>(stmt)) {
+            // Inner loops first, so their hoisted temporaries can move further out
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& body) { optimizeBlock(body, false); });
+
+            for (const auto& hoisted : hoistFromLoop(stmt)) {
+                auto temp = std::static_pointer_cast<VarDecl>(hoisted);
+                if (programLevel) {
+                    // Top-level declarations become C++ globals initialized ahead of
+                    // all other statements, so assign the value in place instead
+                    auto target = std::make_shared<Identifier>(temp->name);
+                    target->type = temp->type;
+                    auto assignment = std::make_shared<Assignment>(target, temp->initializer);
+                    assignment->Expression::type = temp->type;
+                    result.push_back(std::make_shared<VarDecl>(false, temp->type, temp->name, nullptr));
+                    result.push_back(std::make_shared<ExpressionStatement>(assignment));
+                } else {
+                    result.push_back(hoisted);
+                }
+            }
+        } else {
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { optimizeBlock(nested, false); });
+        }
+        result.push_back(stmt);
+    }
+    block = std::move(result);
+}
+
+std::vector<StmtPtr> LoopInvariantCodeMotion::hoistFromLoop(const StmtPtr& loop) {
+    LoopEffects loopEffects;
+    collectLoopEffects(loop, loopEffects);
+
+    std::vector<StmtPtr> preheader;
+    if (auto whileStmt = std::dynamic_pointer_cast<While>(loop)) {
+        hoistFromExpression(whileStmt->condition, loopEffects, preheader);
+        hoistFromBlock(whileStmt->body, loopEffects, preheader);
+    } else if (auto forStmt = std::dynamic_pointer_cast<For>(loop)) {
+        // The bounds of a for loop are already evaluated only once
+        hoistFromBlock(forStmt->body, loopEffects, preheader);
+    }
+    return preheader;
+}
+
+void LoopInvariantCodeMotion::hoistFromBlock(std::vector<StmtPtr>& block, const LoopEffects& loopEffects,
+                                             std::vector<StmtPtr>& preheader) {
+    std::vector<StmtPtr> kept;
+    for (const auto& stmt : block) {
+        if (isTemporary(stmt)) {
+            auto temp = std::static_pointer_cast<VarDecl>(stmt);
+            if (isInvariant(temp->initializer, loopEffects)) {
+                preheader.push_back(stmt);
+                continue;
+            }
+        }
+
+        if (std::dynamic_pointer_cast<While>(stmt)) {
+            // Already handled when the inner loop was optimized
+            kept.push_back(stmt);
+            continue;
+        }
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+            hoistFromExpression(expr, loopEffects, preheader);
+        });
+        if (!std::dynamic_pointer_cast<For>(stmt)) {
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+                hoistFromBlock(nested, loopEffects, preheader);
+            });
+        }
+        kept.push_back(stmt);
+    }
+    block = std::move(kept);
+}
+
+void LoopInvariantCodeMotion::hoistFromExpression(ExprPtr& expr, const LoopEffects& loopEffects,
+                                                  std::vector<StmtPtr>& preheader) {
+    if (!expr) return;
+    if (isHoistable(expr) && isInvariant(expr, loopEffects)) {
+        std::string name = TEMP_PREFIX + std::to_string(tempCounter++);
+        preheader.push_back(std::make_shared<VarDecl>(false, expr->type, name, expr));
+
+        auto temp = std::make_shared<Identifier>(name);
+        temp->type = expr->type;
+        temp->line = expr->line;
+        temp->column = expr->column;
+        expr = temp;
+        ++hoistedCount;
+        return;
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { hoistFromExpression(sub, loopEffects, preheader); });
+}
+
+void LoopInvariantCodeMotion::collectLoopEffects(const StmtPtr& stmt, LoopEffects& loopEffects) const {
+    if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+        loopEffects.assigned.insert(varDecl->name);
+    } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+        loopEffects.assigned.insert(forStmt->iterator);
+    } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+        loopEffects.assigned.insert(tryCatch->exceptionName);
+    }
+    ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { collectLoopEffects(expr, loopEffects); });
+    ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+        for (const auto& s : nested) {
+            collectLoopEffects(s, loopEffects);
+        }
+    });
+}
+
+void LoopInvariantCodeMotion::collectLoopEffects(const ExprPtr& expr, LoopEffects& loopEffects) const {
+    if (!expr) return;
+    if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        if (auto target = std::dynamic_pointer_cast<Identifier>(assignment->target)) {
+            loopEffects.assigned.insert(target->name);
+        }
+    } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+            if (ASTUtils::isMutatingListMethod(member->memberName)) {
+                if (auto object = std::dynamic_pointer_cast<Identifier>(member->object)) {
+                    loopEffects.resized.insert(object->name);
+                }
+                loopEffects.resizedTypes.insert(ASTUtils::typeName(member->object->type));
+            }
+        }
+
+        std::string callee = ASTUtils::calledFunctionName(call);
+        if (!callee.empty()) {
+            const FunctionEffects& calleeEffects = effects->effectsOf(callee);
+            loopEffects.assigned.insert(calleeEffects.writtenGlobals.begin(), calleeEffects.writtenGlobals.end());
+            for (size_t index : calleeEffects.mutatedParams) {
+                if (index >= call->arguments.size()) continue;
+                const ExprPtr& arg = call->arguments[index];
+                if (auto ident = std::dynamic_pointer_cast<Identifier>(arg)) {
+                    loopEffects.resized.insert(ident->name);
+                }
+                loopEffects.resizedTypes.insert(ASTUtils::typeName(arg->type));
+            }
+        }
+    }
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { collectLoopEffects(sub, loopEffects); });
+}
+
+bool LoopInvariantCodeMotion::isInvariant(const ExprPtr& expr, const LoopEffects& loopEffects) const {
+    if (!expr) return false;
+    if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+        return !std::holds_alternative<std::vector<ExprPtr>>(literal->value);
+    }
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        // Lists and matrices are only invariant through their size, checked below
+        if (ident->type && (ident->type->kind == Type::Kind::LIST || ident->type->kind == Type::Kind::MATRIX)) {
+            return false;
+        }
+        return !loopEffects.assigned.count(ident->name);
+    }
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        return isInvariant(binaryOp->left, loopEffects) && isInvariant(binaryOp->right, loopEffects);
+    }
+    if (auto unaryOp = std::dynamic_pointer_cast<UnaryOp>(expr)) {
+        return isInvariant(unaryOp->operand, loopEffects);
+    }
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+        if (!member) return false;
+
+        auto list = std::dynamic_pointer_cast<Identifier>(member->object);
+        bool isMatrix = list && list->type && list->type->kind == Type::Kind::MATRIX;
+        if (list && list->type && (list->type->kind == Type::Kind::LIST || isMatrix)) {
+            bool size = isMatrix ? member->memberName == "rows" || member->memberName == "cols"
+                                 : member->memberName == "length";
+            if (!size || loopEffects.assigned.count(list->name) ||
+                loopEffects.resized.count(list->name) ||
+                loopEffects.resizedTypes.count(ASTUtils::typeName(list->type))) {
+                return false;
+            }
+        } else if (!isInvariant(member->object, loopEffects)) {
+            return false;
+        }
+        for (const auto& arg : call->arguments) {
+            if (!isInvariant(arg, loopEffects)) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool LoopInvariantCodeMotion::isHoistable(const ExprPtr& expr) {
+    if (!expr->type) return false;
+    Type::Kind kind = expr->type->kind;
+    if (kind != Type::Kind::INT && kind != Type::Kind::FLOAT && kind != Type::Kind::BOOL) return false;
+
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        // Cheap builtin methods only: hoisting evaluates them even when the
+        // loop body would not have
+        auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+        if (!member) return false;
+        const std::string& name = member->memberName;
+        if (name != "length" && name != "rows" && name != "cols" && name != "abs" && name != "sqrt" &&
+            name != "round" && name != "isEven" && name != "power") {
+            return false;
+        }
+    } else if (!std::dynamic_pointer_cast<BinaryOp>(expr) && !std::dynamic_pointer_cast<UnaryOp>(expr)) {
+        return false;
+    }
+    if (ASTUtils::hasSideEffects(expr) || ASTUtils::mayTrap(expr)) return false;
+
+    // Constant expressions are left for folding
+    std::unordered_set<std::string> reads;
+    ASTUtils::collectReads(expr, reads);
+    reads.erase("Math");
+    return !reads.empty();
+}
+
+bool LoopInvariantCodeMotion::isTemporary(const StmtPtr& stmt) {
+    auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+    return varDecl && varDecl->initializer && varDecl->name.rfind(TEMP_PREFIX, 0) == 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+#include "EffectAnalysis.h"
+
+// Moves pure loop-invariant expressions out of `for` bodies and `while`
+// conditions/bodies into temporaries computed once before the loop.
+// Only scalar results that cannot fail at runtime are hoisted, so
+// evaluating them ahead of the loop is always safe. `.length()` of a list
+// counts as invariant when the loop neither reassigns nor resizes it,
+// directly or through a called function.
+class LoopInvariantCodeMotion {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    int getHoistedCount() const;
+
+private:
+    struct LoopEffects {
+        std::unordered_set<std::string> assigned;
+        std::unordered_set<std::string> resized;
+        // Lists of these types may have been resized through an alias
+        std::unordered_set<std::string> resizedTypes;
+    };
+
+    std::unique_ptr<EffectAnalysis> effects;
+    int tempCounter = 0;
+    int hoistedCount = 0;
+
+    void optimizeBlock(std::vector<StmtPtr>& block, bool programLevel);
+    std::vector<StmtPtr> hoistFromLoop(const StmtPtr& loop);
+    void hoistFromBlock(std::vector<StmtPtr>& block, const LoopEffects& loopEffects, std::vector<StmtPtr>& preheader);
+    void hoistFromExpression(ExprPtr& expr, const LoopEffects& loopEffects, std::vector<StmtPtr>& preheader);
+
+    void collectLoopEffects(const StmtPtr& stmt, LoopEffects& loopEffects) const;
+    void collectLoopEffects(const ExprPtr& expr, LoopEffects& loopEffects) const;
+    bool isInvariant(const ExprPtr& expr, const LoopEffects& loopEffects) const;
+
+    static bool isHoistable(const ExprPtr& expr);
+    static bool isTemporary(const StmtPtr& stmt);
+};
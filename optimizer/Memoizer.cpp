@@ -0,0 +1,67 @@
+#include "Memoizer.h"
+#include "ASTUtils.h"
+#include "CallGraph.h"
+#include "EffectAnalysis.h"
+
+Memoizer::Memoizer(bool memoizeAll) : memoizeAll(memoizeAll) {}
+
+void Memoizer::run(const std::shared_ptr<Program>& program) {
+    memoizedFunctions.clear();
+    constantGlobals.clear();
+    for (const auto& stmt : program->statements) {
+        auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+        if (varDecl && varDecl->isConst && isScalar(varDecl->type)) {
+            constantGlobals.insert(varDecl->name);
+        }
+    }
+
+    CallGraph callGraph(program);
+    EffectAnalysis effects(program);
+    for (const auto& stmt : program->statements) {
+        auto func = std::dynamic_pointer_cast<Function>(stmt);
+        if (!func || func->parameters.empty() || func->name == "main") continue;
+        if (!memoizeAll && !callGraph.isRecursive(func->name)) continue;
+
+        bool scalarParams = true;
+        for (const auto& param : func->parameters) {
+            scalarParams = scalarParams && isScalar(param.first);
+        }
+        int returns = 0;
+        if (!scalarParams || !returnsScalars(func->body, returns) || returns == 0 || !effects.isPure(func->name)) {
+            continue;
+        }
+
+        // A cached result must not depend on state that changes between calls
+        bool stableReads = true;
+        for (const auto& global : effects.effectsOf(func->name).readGlobals) {
+            stableReads = stableReads && constantGlobals.count(global) > 0;
+        }
+        if (!stableReads) continue;
+
+        func->memoize = true;
+        memoizedFunctions.push_back(func->name);
+    }
+}
+
+const std::vector<std::string>& Memoizer::getMemoizedFunctions() const {
+    return memoizedFunctions;
+}
+
+bool Memoizer::isScalar(const TypePtr& type) {
+    if (!type) return false;
+    return type->kind == Type::Kind::INT || type->kind == Type::Kind::FLOAT ||
+           type->kind == Type::Kind::BOOL || type->kind == Type::Kind::STRING;
+}
+
+bool Memoizer::returnsScalars(const std::vector<StmtPtr>& block, int& returns) {
+    for (const auto& stmt : block) {
+        if (auto returnStmt = std::dynamic_pointer_cast<Return>(stmt)) {
+            if (!returnStmt->value || !isScalar(returnStmt->value->type)) return false;
+            ++returns;
+        }
+        bool ok = true;
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { ok = ok && returnsScalars(nested, returns); });
+        if (!ok) return false;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Marks pure functions whose results can be cached by their arguments,
+// which the backends emit as a memo table. Only functions taking and
+// returning scalars qualify, and any global they read must be a scalar
+// constant. Recursive functions are always considered; with memoizeAll,
+// non-recursive ones are as well.
+class Memoizer {
+public:
+    explicit Memoizer(bool memoizeAll);
+    void run(const std::shared_ptr<Program>& program);
+    const std::vector<std::string>& getMemoizedFunctions() const;
+
+private:
+    bool memoizeAll;
+    std::unordered_set<std::string> constantGlobals;
+    std::vector<std::string> memoizedFunctions;
+
+    static bool isScalar(const TypePtr& type);
+    static bool returnsScalars(const std::vector<StmtPtr>& block, int& returns);
+};
@@ -0,0 +1,155 @@
+#include "Optimizer.h"
+#include "AutoParallelizer.h"
+#include "CommonSubexpressionEliminator.h"
+#include "ContainerSelection.h"
+#include "CopyElimination.h"
+#include "DeadCodeEliminator.h"
+#include "Inliner.h"
+#include "LoopInvariantCodeMotion.h"
+#include "Memoizer.h"
+#include "ParameterPassing.h"
+#include "StrengthReducer.h"
+#include "StringBuilder.h"
+#include "TailCallEliminator.h"
+
+Optimizer::Optimizer(OptimizerOptions options) : options(options) {}
+
+void Optimizer::optimize(const std::shared_ptr<Program>& program) {
+    if (!options.enabled) {
+        return;
+    }
+
+    if (options.eliminateTailCalls) {
+        TailCallEliminator eliminator;
+        eliminator.run(program);
+        for (const auto& name : eliminator.getConvertedFunctions()) {
+            diagnostics.push_back("Converted recursion in function '" + name + "' into a loop");
+        }
+    }
+
+    if (options.inlineFunctions) {
+        Inliner inliner(options.inlineThreshold);
+        inliner.run(program);
+        for (const auto& name : inliner.getInlinedFunctions()) {
+            diagnostics.push_back("Inlined calls to function '" + name + "'");
+        }
+    }
+
+    if (options.eliminateDeadCode) {
+        DeadCodeEliminator eliminator;
+        eliminator.run(program);
+        for (const auto& name : eliminator.getRemovedFunctions()) {
+            diagnostics.push_back("Removed unused function '" + name + "'");
+        }
+    }
+
+    if (options.memoizeRecursive || options.memoizeAll) {
+        Memoizer memoizer(options.memoizeAll);
+        memoizer.run(program);
+        for (const auto& name : memoizer.getMemoizedFunctions()) {
+            diagnostics.push_back("Memoized results of function '" + name + "'");
+        }
+    }
+
+    if (options.reduceStrength) {
+        StrengthReducer reducer(!options.targetsCpp);
+        reducer.run(program);
+        if (reducer.getRewriteCount() > 0) {
+            diagnostics.push_back("Simplified " + std::to_string(reducer.getRewriteCount()) +
+                                  " arithmetic expression(s)");
+        }
+    }
+
+    // Before LICM and CSE, which can move an index such as `xs.length() - 1`
+    // into a temporary and hide that it is at the end of the list
+    if (options.selectContainers) {
+        ContainerSelection selection;
+        selection.run(program);
+        if (selection.getArrayCount() > 0) {
+            diagnostics.push_back("Stored " + std::to_string(selection.getArrayCount()) +
+                                  " fixed-size list(s) in an array");
+        }
+        if (selection.getSmallCount() > 0) {
+            diagnostics.push_back("Stored " + std::to_string(selection.getSmallCount()) +
+                                  " short list(s) in inline storage");
+        }
+        if (selection.getDequeCount() > 0) {
+            diagnostics.push_back("Stored " + std::to_string(selection.getDequeCount()) +
+                                  " queue-like list(s) in a deque");
+        }
+        if (selection.getReservedCount() > 0) {
+            diagnostics.push_back("Reserved room for " + std::to_string(selection.getReservedCount()) +
+                                  " list(s) appended to by a loop");
+        }
+    }
+
+    if (options.hoistLoopInvariants) {
+        LoopInvariantCodeMotion licm;
+        licm.run(program);
+        if (licm.getHoistedCount() > 0) {
+            diagnostics.push_back("Hoisted " + std::to_string(licm.getHoistedCount()) +
+                                  " loop-invariant expression(s)");
+        }
+    }
+
+    // After LICM, so temporaries hoisted from sibling loops can be shared
+    if (options.eliminateCommonSubexpressions) {
+        CommonSubexpressionEliminator cse;
+        cse.run(program);
+        if (cse.getReusedCount() > 0) {
+            diagnostics.push_back("Reused " + std::to_string(cse.getReusedCount()) +
+                                  " common subexpression(s)");
+        }
+    }
+
+    // After LICM and CSE, whose temporaries are then either computed before
+    // the loop or local to one iteration
+    if (options.autoParallelize) {
+        AutoParallelizer parallelizer(options.parallelThreshold);
+        parallelizer.run(program);
+        for (const auto& loop : parallelizer.getParallelizedLoops()) {
+            diagnostics.push_back("Parallelized " + loop);
+        }
+    }
+
+    // Last, once no later pass can introduce writes to a parameter
+    if (options.constRefParams) {
+        ParameterPassing passing;
+        passing.run(program);
+        if (passing.getConstRefCount() > 0) {
+            diagnostics.push_back("Passed " + std::to_string(passing.getConstRefCount()) +
+                                  " list/string parameter(s) by const reference");
+        }
+    }
+
+    if (options.buildStrings) {
+        StringBuilder builder;
+        builder.run(program);
+        if (builder.getBuiltCount() > 0) {
+            diagnostics.push_back("Built " + std::to_string(builder.getBuiltCount()) +
+                                  " string(s) from parts across a loop");
+        }
+    }
+
+    // Needs to know which parameters are taken by reference
+    if (options.eliminateCopies) {
+        CopyElimination copies;
+        copies.run(program);
+        if (copies.getMovedCount() > 0) {
+            diagnostics.push_back("Moved " + std::to_string(copies.getMovedCount()) +
+                                  " list/string value(s) at their last use");
+        }
+        if (copies.getBoundCount() > 0) {
+            diagnostics.push_back("Bound " + std::to_string(copies.getBoundCount()) +
+                                  " local(s) by const reference");
+        }
+        if (copies.getAppendCount() > 0) {
+            diagnostics.push_back("Appended to " + std::to_string(copies.getAppendCount()) +
+                                  " string(s) in place");
+        }
+    }
+}
+
+const std::vector<std::string>& Optimizer::getDiagnostics() const {
+    return diagnostics;
+}
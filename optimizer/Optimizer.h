@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ast/AST.h"
+
+struct OptimizerOptions {
+    bool enabled = true;
+    bool eliminateTailCalls = true;
+    bool eliminateDeadCode = true;
+    bool inlineFunctions = true;
+    // Largest return expression, in AST nodes, that is still inlined
+    int inlineThreshold = 32;
+    bool memoizeRecursive = true;
+    // Also cache results of pure non-recursive functions
+    bool memoizeAll = false;
+    bool reduceStrength = true;
+    bool hoistLoopInvariants = true;
+    bool eliminateCommonSubexpressions = true;
+    bool constRefParams = true;
+    bool eliminateCopies = true;
+    // Build strings that a loop appends to from a list of parts (Python)
+    bool buildStrings = true;
+    // Store local lists used as queues in a deque, and reserve room for
+    // lists a loop appends to
+    bool selectContainers = true;
+    // Run independent `for` loops on several threads in the generated C++
+    bool autoParallelize = false;
+    // Loops with fewer iterations than this are not run in parallel
+    long long parallelThreshold = 256;
+    // The backend the tree is generated for: C++ computes int.power(k) as
+    // a double, so only Python may turn it into int multiplications
+    bool targetsCpp = true;
+};
+
+// Runs the AST-level optimization passes between semantic analysis and
+// code generation. Both backends consume the optimized tree.
+class Optimizer {
+public:
+    explicit Optimizer(OptimizerOptions options);
+    void optimize(const std::shared_ptr<Program>& program);
+    const std::vector<std::string>& getDiagnostics() const;
+
+private:
+    OptimizerOptions options;
+    std::vector<std::string> diagnostics;
+};
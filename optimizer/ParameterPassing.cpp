@@ -0,0 +1,63 @@
+#include "ParameterPassing.h"
+#include "ASTUtils.h"
+#include "EffectAnalysis.h"
+#include <unordered_map>
+
+void ParameterPassing::run(const std::shared_ptr<Program>& program) {
+    std::unordered_map<std::string, TypePtr> globalTypes;
+    for (const auto& stmt : program->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            globalTypes[varDecl->name] = varDecl->type;
+        }
+    }
+
+    EffectAnalysis effects(program);
+    for (const auto& stmt : program->statements) {
+        auto func = std::dynamic_pointer_cast<Function>(stmt);
+        if (!func) continue;
+
+        std::unordered_set<std::string> modified;
+        collectModified(func->body, modified);
+        const FunctionEffects& funcEffects = effects.effectsOf(func->name);
+
+        func->constRefParams.assign(func->parameters.size(), false);
+        for (size_t i = 0; i < func->parameters.size(); ++i) {
+            const auto& [type, name] = func->parameters[i];
+            // Scalars are cheaper to copy than to reference
+            if (type->kind != Type::Kind::LIST && type->kind != Type::Kind::MATRIX && type->kind != Type::Kind::STRING) {
+                continue;
+            }
+            if (modified.count(name)) continue;
+
+            bool aliasable = false;
+            for (const auto& global : funcEffects.writtenGlobals) {
+                auto it = globalTypes.find(global);
+                aliasable = aliasable || (it != globalTypes.end() && EffectAnalysis::typeContains(it->second, type));
+            }
+            if (aliasable) continue;
+
+            func->constRefParams[i] = true;
+            ++constRefCount;
+        }
+    }
+}
+
+int ParameterPassing::getConstRefCount() const {
+    return constRefCount;
+}
+
+void ParameterPassing::collectModified(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& names) {
+    for (const auto& stmt : block) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            names.insert(varDecl->name);
+        } else if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            names.insert(forStmt->iterator);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            names.insert(tryCatch->exceptionName);
+        }
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+            ASTUtils::collectWrittenVariables(expr, names);
+        });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { collectModified(nested, names); });
+    }
+}
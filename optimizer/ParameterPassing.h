@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Finds list and string parameters that a function never modifies, which
+// the C++ backend then takes by const reference instead of copying the
+// argument. A parameter only qualifies if the function (or anything it
+// calls) writes no global that could hold the same value, since the
+// reference would observe that write where a copy would not.
+class ParameterPassing {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    int getConstRefCount() const;
+
+private:
+    int constRefCount = 0;
+
+    static void collectModified(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& names);
+};
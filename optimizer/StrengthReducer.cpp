@@ -0,0 +1,293 @@
+#include "StrengthReducer.h"
+#include "ASTUtils.h"
+#include <climits>
+
+static bool isIntType(const ExprPtr& expr) {
+    return expr->type && expr->type->kind == Type::Kind::INT;
+}
+
+static bool sameKind(const ExprPtr& a, const ExprPtr& b) {
+    return a->type && b->type && a->type->kind == b->type->kind;
+}
+
+static int powerOfTwoExponent(int value) {
+    if (value < 2 || (value & (value - 1)) != 0) return -1;
+    int exponent = 0;
+    while ((1 << exponent) != value) ++exponent;
+    return exponent;
+}
+
+static void collectAssignedNames(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& names) {
+    for (const auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) {
+            std::function<void(const ExprPtr&)> visit = [&](const ExprPtr& e) {
+                if (auto assignment = std::dynamic_pointer_cast<Assignment>(e)) {
+                    if (auto target = std::dynamic_pointer_cast<Identifier>(assignment->target)) {
+                        names.insert(target->name);
+                    }
+                }
+                ASTUtils::forEachSubExpression(e, [&](ExprPtr& sub) { visit(sub); });
+            };
+            visit(expr);
+        });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { collectAssignedNames(nested, names); });
+    }
+}
+
+StrengthReducer::StrengthReducer(bool reducePowers) : reducePowers(reducePowers) {}
+
+void StrengthReducer::run(const std::shared_ptr<Program>& program) {
+    constants.clear();
+    for (const auto& stmt : program->statements) {
+        auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+        if (!varDecl || !varDecl->isConst || varDecl->type->kind != Type::Kind::INT) continue;
+        auto literal = std::dynamic_pointer_cast<Literal>(varDecl->initializer);
+        if (literal && std::holds_alternative<int>(literal->value)) {
+            constants[varDecl->name] = { varDecl->type, std::get<int>(literal->value) };
+        }
+    }
+    reduceBlock(program->statements);
+}
+
+int StrengthReducer::getRewriteCount() const {
+    return rewriteCount;
+}
+
+void StrengthReducer::reduceBlock(std::vector<StmtPtr>& block) {
+    for (auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { reduceExpression(expr); });
+
+        if (auto forStmt = std::dynamic_pointer_cast<For>(stmt)) {
+            // Loops run downwards when start > end, so both bounds must be
+            // non-negative for the iterator to be
+            auto saved = nonNegativeNames;
+            std::unordered_set<std::string> assigned;
+            collectAssignedNames(forStmt->body, assigned);
+            if (isNonNegative(forStmt->start) && isNonNegative(forStmt->end) && !assigned.count(forStmt->iterator)) {
+                nonNegativeNames.insert(forStmt->iterator);
+            } else {
+                nonNegativeNames.erase(forStmt->iterator);
+            }
+            reduceBlock(forStmt->body);
+            nonNegativeNames = std::move(saved);
+        } else {
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { reduceBlock(nested); });
+        }
+    }
+}
+
+void StrengthReducer::reduceExpression(ExprPtr& expr) {
+    if (!expr) return;
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { reduceExpression(sub); });
+
+    while (true) {
+        ExprPtr simplified;
+        if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+            simplified = simplifyBinary(binaryOp);
+        } else if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+            simplified = simplifyCall(call);
+        }
+        if (!simplified) break;
+        expr = simplified;
+        ++rewriteCount;
+    }
+}
+
+ExprPtr StrengthReducer::simplifyBinary(const std::shared_ptr<BinaryOp>& binaryOp) {
+    using Op = BinaryOp::Operator;
+    const ExprPtr& left = binaryOp->left;
+    const ExprPtr& right = binaryOp->right;
+    int leftValue = 0;
+    int rightValue = 0;
+    bool leftConst = constantValue(left, leftValue);
+    bool rightConst = constantValue(right, rightValue);
+
+    // Constant folding; results that would overflow or go negative are left
+    // alone so both backends keep printing the same thing
+    if (leftConst && rightConst && isIntType(binaryOp)) {
+        long long folded = -1;
+        switch (binaryOp->op) {
+            case Op::ADD: folded = (long long)leftValue + rightValue; break;
+            case Op::SUB: folded = (long long)leftValue - rightValue; break;
+            case Op::MUL: folded = (long long)leftValue * rightValue; break;
+            case Op::DIV:
+                if (leftValue >= 0 && rightValue > 0) folded = leftValue / rightValue;
+                break;
+            case Op::MOD:
+                if (leftValue >= 0 && rightValue > 0) folded = leftValue % rightValue;
+                break;
+            default: break;
+        }
+        if (folded >= 0 && folded <= INT_MAX) {
+            return makeInt(static_cast<int>(folded), binaryOp);
+        }
+    }
+
+    // Identities, only where the remaining operand already has the result type
+    switch (binaryOp->op) {
+        case Op::ADD:
+            if (rightConst && rightValue == 0 && sameKind(left, binaryOp)) return left;
+            if (leftConst && leftValue == 0 && sameKind(right, binaryOp)) return right;
+            break;
+        case Op::SUB:
+            if (rightConst && rightValue == 0 && sameKind(left, binaryOp)) return left;
+            break;
+        case Op::MUL:
+            if (rightConst && rightValue == 1 && sameKind(left, binaryOp)) return left;
+            if (leftConst && leftValue == 1 && sameKind(right, binaryOp)) return right;
+            break;
+        case Op::DIV:
+            if (rightConst && rightValue == 1 && isIntType(left) && isIntType(binaryOp)) return left;
+            break;
+        default:
+            break;
+    }
+
+    if ((binaryOp->op == Op::DIV || binaryOp->op == Op::MOD) && isIntType(left) && isIntType(right)) {
+        int exponent = rightConst ? powerOfTwoExponent(rightValue) : -1;
+        if (exponent > 0 && isNonNegative(left)) {
+            if (binaryOp->op == Op::DIV) {
+                return makeBinary(Op::SHR, left, makeInt(exponent, right), binaryOp->type);
+            }
+            return makeBinary(Op::BITAND, left, makeInt(rightValue - 1, right), binaryOp->type);
+        }
+    }
+
+    if ((binaryOp->op == Op::DIV || binaryOp->op == Op::MOD) && !binaryOp->nonZeroDivisor) {
+        auto literal = std::dynamic_pointer_cast<Literal>(right);
+        bool nonZeroFloat = literal && std::holds_alternative<float>(literal->value) &&
+                            std::get<float>(literal->value) != 0.0f;
+        if (nonZeroFloat || isPositive(right) || (rightConst && rightValue != 0)) {
+            binaryOp->nonZeroDivisor = true;
+            ++rewriteCount;
+        }
+    }
+
+    // x % 2 == 0 / != 0 tests parity; the low bit gives the same answer
+    // for negative x in both backends
+    if ((binaryOp->op == Op::EQ || binaryOp->op == Op::NE) && rightConst && rightValue == 0) {
+        auto mod = std::dynamic_pointer_cast<BinaryOp>(left);
+        int modulus = 0;
+        if (mod && mod->op == Op::MOD && isIntType(mod->left) && constantValue(mod->right, modulus) && modulus == 2) {
+            auto lowBit = makeBinary(Op::BITAND, mod->left, makeInt(1, mod->right), mod->type);
+            return makeBinary(binaryOp->op, lowBit, right, binaryOp->type);
+        }
+    }
+
+    return nullptr;
+}
+
+ExprPtr StrengthReducer::simplifyCall(const std::shared_ptr<FunctionCall>& call) {
+    auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+    if (!member || !isIntType(member->object)) return nullptr;
+    const ExprPtr& base = member->object;
+
+    if (member->memberName == "isEven" && call->arguments.empty()) {
+        auto lowBit = makeBinary(BinaryOp::Operator::BITAND, base, makeInt(1, base), base->type);
+        return makeBinary(BinaryOp::Operator::EQ, lowBit, makeInt(0, base), call->type);
+    }
+
+    int exponent = 0;
+    if (reducePowers && member->memberName == "power" && call->arguments.size() == 1 && isIntType(call) &&
+        constantValue(call->arguments[0], exponent) && exponent >= 0 && exponent <= 4) {
+        bool pure = !ASTUtils::hasSideEffects(base) && !ASTUtils::mayTrap(base);
+        if (exponent == 0) {
+            return pure ? makeInt(1, call) : nullptr;
+        }
+        if (exponent == 1) {
+            return base;
+        }
+        // The base is repeated, so it must be cheap to evaluate again
+        if (!std::dynamic_pointer_cast<Identifier>(base) && !std::dynamic_pointer_cast<Literal>(base)) {
+            return nullptr;
+        }
+        ExprPtr product = base;
+        for (int i = 1; i < exponent; ++i) {
+            product = makeBinary(BinaryOp::Operator::MUL, product, ASTUtils::cloneExpression(base), call->type);
+        }
+        return product;
+    }
+    return nullptr;
+}
+
+bool StrengthReducer::constantValue(const ExprPtr& expr, int& value) const {
+    if (auto literal = std::dynamic_pointer_cast<Literal>(expr)) {
+        if (std::holds_alternative<int>(literal->value)) {
+            value = std::get<int>(literal->value);
+            return true;
+        }
+        return false;
+    }
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        // Identifiers share the type object of their declaration, which tells
+        // the global apart from a parameter of the same name
+        auto it = constants.find(ident->name);
+        if (it != constants.end() && ident->type == it->second.first) {
+            value = it->second.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StrengthReducer::isNonNegative(const ExprPtr& expr) const {
+    int value = 0;
+    if (constantValue(expr, value)) return value >= 0;
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        return nonNegativeNames.count(ident->name) > 0;
+    }
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee);
+        return member && member->memberName == "length";
+    }
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        if (!isIntType(binaryOp)) return false;
+        switch (binaryOp->op) {
+            case BinaryOp::Operator::ADD:
+            case BinaryOp::Operator::MUL:
+                return isNonNegative(binaryOp->left) && isNonNegative(binaryOp->right);
+            case BinaryOp::Operator::DIV:
+            case BinaryOp::Operator::MOD:
+                return isNonNegative(binaryOp->left) && isPositive(binaryOp->right);
+            case BinaryOp::Operator::SHR:
+                return isNonNegative(binaryOp->left);
+            case BinaryOp::Operator::BITAND:
+                return isNonNegative(binaryOp->left) || isNonNegative(binaryOp->right);
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool StrengthReducer::isPositive(const ExprPtr& expr) const {
+    int value = 0;
+    if (constantValue(expr, value)) return value > 0;
+    if (auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(expr)) {
+        if (!isIntType(binaryOp)) return false;
+        if (binaryOp->op == BinaryOp::Operator::ADD) {
+            return (isPositive(binaryOp->left) && isNonNegative(binaryOp->right)) ||
+                   (isNonNegative(binaryOp->left) && isPositive(binaryOp->right));
+        }
+        if (binaryOp->op == BinaryOp::Operator::MUL) {
+            return isPositive(binaryOp->left) && isPositive(binaryOp->right);
+        }
+    }
+    return false;
+}
+
+ExprPtr StrengthReducer::makeInt(int value, const ExprPtr& origin) {
+    auto literal = std::make_shared<Literal>(value);
+    literal->type = std::make_shared<Type>(Type::Kind::INT);
+    literal->line = origin->line;
+    literal->column = origin->column;
+    return literal;
+}
+
+ExprPtr StrengthReducer::makeBinary(BinaryOp::Operator op, ExprPtr left, ExprPtr right, const TypePtr& type) {
+    auto binaryOp = std::make_shared<BinaryOp>(op, std::move(left), std::move(right));
+    binaryOp->type = type;
+    binaryOp->line = binaryOp->left->line;
+    binaryOp->column = binaryOp->left->column;
+    return binaryOp;
+}
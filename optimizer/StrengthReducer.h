@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Rewrites arithmetic into cheaper equivalent forms:
+//  - integer constant folding and identities (x * 1, x + 0, x - 0, x / 1)
+//  - x.power(k) for small constant k into repeated multiplication, when
+//    the result is an int in the target (not C++, where it is a double)
+//  - x.isEven() and x % 2 == 0 into a test of the low bit
+//  - division and modulo by a constant power of two into >> and & when
+//    the dividend is known to be non-negative (C++ truncates and Python
+//    floors, so the two only agree with a shift in that case)
+//  - divisions whose divisor can never be zero skip the runtime check
+class StrengthReducer {
+public:
+    explicit StrengthReducer(bool reducePowers);
+    void run(const std::shared_ptr<Program>& program);
+    int getRewriteCount() const;
+
+private:
+    // `const int` globals initialized with a literal
+    std::unordered_map<std::string, std::pair<TypePtr, int>> constants;
+    // Loop iterators in scope that never go below zero
+    std::unordered_set<std::string> nonNegativeNames;
+    bool reducePowers;
+    int rewriteCount = 0;
+
+    void reduceBlock(std::vector<StmtPtr>& block);
+    void reduceExpression(ExprPtr& expr);
+    ExprPtr simplifyBinary(const std::shared_ptr<BinaryOp>& binaryOp);
+    ExprPtr simplifyCall(const std::shared_ptr<FunctionCall>& call);
+
+    bool constantValue(const ExprPtr& expr, int& value) const;
+    bool isNonNegative(const ExprPtr& expr) const;
+    bool isPositive(const ExprPtr& expr) const;
+
+    static ExprPtr makeInt(int value, const ExprPtr& origin);
+    static ExprPtr makeBinary(BinaryOp::Operator op, ExprPtr left, ExprPtr right, const TypePtr& type);
+};
@@ -0,0 +1,128 @@
+#include "StringBuilder.h"
+#include "ASTUtils.h"
+#include <functional>
+
+// The statement and every statement nested in it
+static void forEachStatement(const StmtPtr& stmt, const std::function<void(const StmtPtr&)>& fn) {
+    fn(stmt);
+    ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+        for (const auto& s : nested) {
+            forEachStatement(s, fn);
+        }
+    });
+}
+
+// `s = s + ...` as a statement of its own
+static std::shared_ptr<Assignment> appendStatement(const StmtPtr& stmt) {
+    auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt);
+    auto assignment = exprStmt ? std::dynamic_pointer_cast<Assignment>(exprStmt->expression) : nullptr;
+    if (!assignment || ASTUtils::stringAppendParts(assignment).empty()) return nullptr;
+    return assignment;
+}
+
+void StringBuilder::run(const std::shared_ptr<Program>& program) {
+    Names globals;
+    for (const auto& stmt : program->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) globals.insert(varDecl->name);
+    }
+    for (const auto& stmt : program->statements) {
+        auto func = std::dynamic_pointer_cast<Function>(stmt);
+        if (!func) continue;
+        // Only a function's own strings: a global could be read by any call,
+        // and a local with a global's name may not be in scope at the loop
+        Names strings;
+        for (const auto& param : func->parameters) {
+            if (param.first && param.first->kind == Type::Kind::STRING) strings.insert(param.second);
+        }
+        collectStrings(func->body, strings);
+        for (const auto& name : globals) {
+            strings.erase(name);
+        }
+        visitBlock(func->body, strings, false);
+    }
+}
+
+int StringBuilder::getBuiltCount() const {
+    return builtCount;
+}
+
+void StringBuilder::visitBlock(std::vector<StmtPtr>& block, const Names& strings, bool inTry) {
+    for (const auto& stmt : block) {
+        auto whileStmt = std::dynamic_pointer_cast<While>(stmt);
+        auto forStmt = std::dynamic_pointer_cast<For>(stmt);
+        if ((whileStmt || (forStmt && !forStmt->parallel)) && !inTry) {
+            auto& built = whileStmt ? whileStmt->builtStrings : forStmt->builtStrings;
+            Names inner = strings;
+            for (const auto& name : appendedStrings(stmt)) {
+                if (strings.count(name) && lowerAppends(stmt, name)) {
+                    built.push_back(name);
+                    inner.erase(name);
+                    ++builtCount;
+                }
+            }
+            visitBlock(whileStmt ? whileStmt->body : forStmt->body, inner, inTry);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            visitBlock(tryCatch->tryBlock, strings, true);
+            visitBlock(tryCatch->catchBlock, strings, inTry);
+        } else {
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { visitBlock(nested, strings, inTry); });
+        }
+    }
+}
+
+std::vector<std::string> StringBuilder::appendedStrings(const StmtPtr& loop) {
+    std::vector<std::string> names;
+    Names seen;
+    forEachStatement(loop, [&](const StmtPtr& stmt) {
+        if (auto assignment = appendStatement(stmt)) {
+            const std::string& name = std::dynamic_pointer_cast<Identifier>(assignment->target)->name;
+            if (seen.insert(name).second) names.push_back(name);
+        }
+    });
+    return names;
+}
+
+bool StringBuilder::lowerAppends(const StmtPtr& loop, const std::string& name) {
+    // Each append uses s twice, as its target and its first part; any other
+    // use, or a declaration shadowing s, would see the string mid-build
+    std::vector<std::shared_ptr<Assignment>> appends;
+    int uses = 0;
+    bool declared = false;
+    forEachStatement(loop, [&](const StmtPtr& stmt) {
+        auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+        auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt);
+        if ((varDecl && varDecl->name == name) || (tryCatch && tryCatch->exceptionName == name)) {
+            declared = true;
+        }
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { uses += countUses(expr, name); });
+        auto assignment = appendStatement(stmt);
+        if (assignment && std::dynamic_pointer_cast<Identifier>(assignment->target)->name == name) {
+            appends.push_back(assignment);
+        }
+    });
+    if (declared || appends.empty() || uses != 2 * static_cast<int>(appends.size())) return false;
+    for (const auto& assignment : appends) {
+        assignment->appendInPlace = true;
+    }
+    return true;
+}
+
+void StringBuilder::collectStrings(const std::vector<StmtPtr>& block, Names& strings) {
+    for (const auto& stmt : block) {
+        auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt);
+        if (varDecl && varDecl->type && varDecl->type->kind == Type::Kind::STRING) {
+            strings.insert(varDecl->name);
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { collectStrings(nested, strings); });
+    }
+}
+
+int StringBuilder::countUses(const ExprPtr& expr, const std::string& name) {
+    if (!expr) return 0;
+    if (auto ident = std::dynamic_pointer_cast<Identifier>(expr)) {
+        return ident->name == name ? 1 : 0;
+    }
+    int count = 0;
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { count += countUses(sub, name); });
+    return count;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Finds local strings that a loop only ever appends to, with `s = s + a + b`
+// or `s = s.concat(a)`, and records them on the outermost such loop. The
+// Python backend collects their parts in a list and joins it once after the
+// loop, where each append would otherwise copy the whole string; the C++
+// backend appends in place, which std::string already makes linear.
+// Loops inside a try block are left alone, since a catch block could see
+// the string without the parts appended before the exception.
+class StringBuilder {
+public:
+    void run(const std::shared_ptr<Program>& program);
+    int getBuiltCount() const;
+
+private:
+    using Names = std::unordered_set<std::string>;
+
+    int builtCount = 0;
+
+    void visitBlock(std::vector<StmtPtr>& block, const Names& strings, bool inTry);
+    // Strings appended to anywhere in the loop, in order of appearance
+    static std::vector<std::string> appendedStrings(const StmtPtr& loop);
+    // Marks the appends to name if they are the loop's only uses of it
+    static bool lowerAppends(const StmtPtr& loop, const std::string& name);
+    static void collectStrings(const std::vector<StmtPtr>& block, Names& strings);
+    static int countUses(const ExprPtr& expr, const std::string& name);
+};
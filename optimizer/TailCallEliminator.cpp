@@ -0,0 +1,294 @@
+#include "TailCallEliminator.h"
+#include "ASTUtils.h"
+
+static ExprPtr makeIdentifier(const std::string& name, const TypePtr& type) {
+    auto ident = std::make_shared<Identifier>(name);
+    ident->type = type;
+    return ident;
+}
+
+static StmtPtr makeAssignment(const std::string& name, const TypePtr& type, ExprPtr value) {
+    auto assignment = std::make_shared<Assignment>(makeIdentifier(name, type), std::move(value));
+    assignment->Expression::type = type;
+    return std::make_shared<ExpressionStatement>(assignment);
+}
+
+void TailCallEliminator::run(const std::shared_ptr<Program>& program) {
+    convertedFunctions.clear();
+    globalNames.clear();
+    for (const auto& stmt : program->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            globalNames.insert(varDecl->name);
+        }
+    }
+
+    for (const auto& stmt : program->statements) {
+        auto func = std::dynamic_pointer_cast<Function>(stmt);
+        if (!func) continue;
+
+        Plan plan;
+        if (!analyze(func, plan)) continue;
+        if (plan.accumulates) {
+            plan.accumulator = "__acc" + std::to_string(tempCounter++);
+        }
+
+        std::vector<StmtPtr> body = std::move(func->body);
+        rewriteBlock(func, body, true, plan);
+        // Falling off the end of the body still leaves the function
+        if (body.empty() || (!std::dynamic_pointer_cast<Return>(body.back()) &&
+                             !std::dynamic_pointer_cast<NEXT>(body.back()))) {
+            body.push_back(std::make_shared<ENDLOOP>());
+        }
+
+        auto condition = std::make_shared<Literal>(true);
+        condition->type = std::make_shared<Type>(Type::Kind::BOOL);
+        func->body.clear();
+        if (plan.accumulates) {
+            auto identity = std::make_shared<Literal>(plan.op == BinaryOp::Operator::MUL ? 1 : 0);
+            identity->type = plan.accumulatorType;
+            func->body.push_back(std::make_shared<VarDecl>(false, plan.accumulatorType, plan.accumulator, identity));
+        }
+        func->body.push_back(std::make_shared<While>(condition, std::move(body)));
+        convertedFunctions.push_back(func->name);
+    }
+}
+
+const std::vector<std::string>& TailCallEliminator::getConvertedFunctions() const {
+    return convertedFunctions;
+}
+
+bool TailCallEliminator::analyze(const std::shared_ptr<Function>& func, Plan& plan) const {
+    int totalCalls = countSelfCalls(func->body, func->name);
+    if (totalCalls == 0) return false;
+
+    // Python would need a `global` declaration to assign such a parameter
+    for (const auto& param : func->parameters) {
+        if (globalNames.count(param.second)) return false;
+    }
+
+    // Every recursive call must be one of the recognized return forms
+    int matchedCalls = 0;
+    if (!analyzeBlock(func, func->body, false, true, plan, matchedCalls) || matchedCalls != totalCalls) {
+        return false;
+    }
+    return !plan.accumulates || (!plan.statementCalls && returnsInts(func->body));
+}
+
+bool TailCallEliminator::analyzeBlock(const std::shared_ptr<Function>& func, const std::vector<StmtPtr>& block,
+                                      bool inLoop, bool tailBlock, Plan& plan, int& matchedCalls) const {
+    for (size_t i = 0; i < block.size(); ++i) {
+        const StmtPtr& stmt = block[i];
+        if (tailStatementCall(func, block, i, tailBlock)) {
+            if (inLoop) return false;
+            plan.statementCalls = true;
+            ++matchedCalls;
+            continue;
+        }
+        if (auto returnStmt = std::dynamic_pointer_cast<Return>(stmt)) {
+            if (!returnStmt->value) continue;
+            int calls = countSelfCalls(returnStmt->value, func->name);
+            if (calls == 0) continue;
+            // `next` inside a nested loop would continue that loop instead
+            if (inLoop || calls != 1) return false;
+
+            if (auto call = asSelfCall(returnStmt->value, func->name)) {
+                matchedCalls += countSelfCalls(call, func->name);
+                continue;
+            }
+
+            auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(returnStmt->value);
+            if (!binaryOp || !binaryOp->type || binaryOp->type->kind != Type::Kind::INT ||
+                (binaryOp->op != BinaryOp::Operator::ADD && binaryOp->op != BinaryOp::Operator::MUL)) {
+                return false;
+            }
+            if (plan.accumulates && plan.op != binaryOp->op) return false;
+
+            // Integer + and * are associative and commutative, even when they wrap
+            bool callOnLeft = asSelfCall(binaryOp->left, func->name) != nullptr;
+            const ExprPtr& operand = callOnLeft ? binaryOp->right : binaryOp->left;
+            if (!callOnLeft && !asSelfCall(binaryOp->right, func->name)) return false;
+            if (!operand->type || operand->type->kind != Type::Kind::INT) return false;
+            if (ASTUtils::hasSideEffects(operand) || ASTUtils::mayTrap(operand)) return false;
+
+            plan.accumulates = true;
+            plan.op = binaryOp->op;
+            plan.accumulatorType = binaryOp->type;
+            ++matchedCalls;
+            continue;
+        }
+
+        // A call in a try block returns through its handler, and one in the
+        // catch block through the handlers of the frames it would replace
+        if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            if (countSelfCalls(tryCatch->tryBlock, func->name) + countSelfCalls(tryCatch->catchBlock, func->name) > 0) {
+                return false;
+            }
+        }
+
+        bool nestedLoop = inLoop || std::dynamic_pointer_cast<For>(stmt) || std::dynamic_pointer_cast<While>(stmt);
+        bool nestedTail = isTailBranch(block, i, tailBlock);
+        bool ok = true;
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+            if (ok && !analyzeBlock(func, nested, nestedLoop, nestedTail, plan, matchedCalls)) ok = false;
+        });
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool TailCallEliminator::returnsInts(const std::vector<StmtPtr>& block) {
+    // Base cases combine their value with the accumulator
+    for (const auto& stmt : block) {
+        if (auto returnStmt = std::dynamic_pointer_cast<Return>(stmt)) {
+            if (!returnStmt->value || !returnStmt->value->type ||
+                returnStmt->value->type->kind != Type::Kind::INT) {
+                return false;
+            }
+        }
+        bool ok = true;
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { ok = ok && returnsInts(nested); });
+        if (!ok) return false;
+    }
+    return true;
+}
+
+void TailCallEliminator::rewriteBlock(const std::shared_ptr<Function>& func, std::vector<StmtPtr>& block,
+                                      bool tailBlock, Plan& plan) {
+    std::vector<StmtPtr> result;
+    for (size_t i = 0; i < block.size(); ++i) {
+        const StmtPtr& stmt = block[i];
+        if (auto call = tailStatementCall(func, block, i, tailBlock)) {
+            for (const auto& rebind : rebindParameters(func, call)) {
+                result.push_back(rebind);
+            }
+            result.push_back(std::make_shared<NEXT>());
+            // Also drops the `return;` that may follow
+            break;
+        }
+
+        auto returnStmt = std::dynamic_pointer_cast<Return>(stmt);
+        if (!returnStmt || !returnStmt->value) {
+            bool nestedTail = isTailBranch(block, i, tailBlock);
+            ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) {
+                rewriteBlock(func, nested, nestedTail, plan);
+            });
+            result.push_back(stmt);
+            continue;
+        }
+
+        std::shared_ptr<FunctionCall> call = asSelfCall(returnStmt->value, func->name);
+        auto binaryOp = std::dynamic_pointer_cast<BinaryOp>(returnStmt->value);
+        if (!call && binaryOp && countSelfCalls(binaryOp, func->name) == 1) {
+            bool callOnLeft = (call = asSelfCall(binaryOp->left, func->name)) != nullptr;
+            if (!callOnLeft) call = asSelfCall(binaryOp->right, func->name);
+
+            // Fold the other operand in before the parameters change
+            const ExprPtr& operand = callOnLeft ? binaryOp->right : binaryOp->left;
+            auto folded = std::make_shared<BinaryOp>(plan.op, makeIdentifier(plan.accumulator, plan.accumulatorType),
+                                                     operand);
+            folded->type = plan.accumulatorType;
+            result.push_back(makeAssignment(plan.accumulator, plan.accumulatorType, folded));
+        }
+
+        if (call) {
+            for (const auto& rebind : rebindParameters(func, call)) {
+                result.push_back(rebind);
+            }
+            result.push_back(std::make_shared<NEXT>());
+            // Anything after the call in this block was unreachable anyway
+            break;
+        }
+
+        if (plan.accumulates) {
+            auto combined = std::make_shared<BinaryOp>(plan.op, makeIdentifier(plan.accumulator, plan.accumulatorType),
+                                                       returnStmt->value);
+            combined->type = plan.accumulatorType;
+            combined->line = returnStmt->value->line;
+            combined->column = returnStmt->value->column;
+            returnStmt->value = combined;
+        }
+        result.push_back(stmt);
+    }
+    block = std::move(result);
+}
+
+std::vector<StmtPtr> TailCallEliminator::rebindParameters(const std::shared_ptr<Function>& func,
+                                                          const std::shared_ptr<FunctionCall>& call) {
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < func->parameters.size() && i < call->arguments.size(); ++i) {
+        auto ident = std::dynamic_pointer_cast<Identifier>(call->arguments[i]);
+        if (!ident || ident->name != func->parameters[i].second) changed.push_back(i);
+    }
+
+    // Assigning in order is only safe if no later argument reads a
+    // parameter that was already overwritten
+    bool needsTemps = false;
+    for (size_t a = 0; a < changed.size() && !needsTemps; ++a) {
+        for (size_t b = a + 1; b < changed.size() && !needsTemps; ++b) {
+            std::unordered_set<std::string> reads;
+            ASTUtils::collectReads(call->arguments[changed[b]], reads);
+            needsTemps = reads.count(func->parameters[changed[a]].second) > 0;
+        }
+    }
+
+    std::vector<StmtPtr> statements;
+    std::vector<std::string> temps;
+    for (size_t i : changed) {
+        const auto& param = func->parameters[i];
+        if (needsTemps) {
+            temps.push_back("__tc" + std::to_string(tempCounter++));
+            statements.push_back(std::make_shared<VarDecl>(false, param.first, temps.back(), call->arguments[i]));
+        } else {
+            statements.push_back(makeAssignment(param.second, param.first, call->arguments[i]));
+        }
+    }
+    for (size_t t = 0; t < temps.size(); ++t) {
+        const auto& param = func->parameters[changed[t]];
+        statements.push_back(makeAssignment(param.second, param.first, makeIdentifier(temps[t], param.first)));
+    }
+    return statements;
+}
+
+std::shared_ptr<FunctionCall> TailCallEliminator::tailStatementCall(const std::shared_ptr<Function>& func,
+                                                                   const std::vector<StmtPtr>& block, size_t index,
+                                                                   bool tailBlock) {
+    // A call whose result is discarded is a tail call if nothing runs after it
+    auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(block[index]);
+    if (!exprStmt) return nullptr;
+    bool last = index + 1 == block.size() && tailBlock;
+    auto next = index + 1 < block.size() ? std::dynamic_pointer_cast<Return>(block[index + 1]) : nullptr;
+    if (!last && !(next && !next->value)) return nullptr;
+    return asSelfCall(exprStmt->expression, func->name);
+}
+
+bool TailCallEliminator::isTailBranch(const std::vector<StmtPtr>& block, size_t index, bool tailBlock) {
+    // The branches of a final if also end the function
+    if (!tailBlock || index + 1 != block.size()) return false;
+    return std::dynamic_pointer_cast<If>(block[index]) != nullptr;
+}
+
+std::shared_ptr<FunctionCall> TailCallEliminator::asSelfCall(const ExprPtr& expr, const std::string& name) {
+    if (ASTUtils::calledFunctionName(expr) != name) return nullptr;
+    auto call = std::static_pointer_cast<FunctionCall>(expr);
+    // A recursive call among the arguments is not a tail call
+    for (const auto& arg : call->arguments) {
+        if (countSelfCalls(arg, name) > 0) return nullptr;
+    }
+    return call;
+}
+
+int TailCallEliminator::countSelfCalls(const ExprPtr& expr, const std::string& name) {
+    if (!expr) return 0;
+    int count = ASTUtils::calledFunctionName(expr) == name ? 1 : 0;
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { count += countSelfCalls(sub, name); });
+    return count;
+}
+
+int TailCallEliminator::countSelfCalls(const std::vector<StmtPtr>& block, const std::string& name) {
+    int count = 0;
+    for (const auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, [&](ExprPtr& expr) { count += countSelfCalls(expr, name); });
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { count += countSelfCalls(nested, name); });
+    }
+    return count;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ast/AST.h"
+
+// Turns self-recursive functions into loops when every recursive call is
+// either a tail call (`return f(...)`) or an integer accumulation such as
+// `return n * f(n - 1)`. The body is wrapped in `while (true)`; a tail
+// call assigns the new arguments to the parameters and continues, and an
+// accumulation first folds its other operand into an __accN variable that
+// the base cases combine with their result.
+class TailCallEliminator {
+public:
+    void run(const std::shared_ptr<Program>& program);
+
+    // Functions that were rewritten into loops.
+    const std::vector<std::string>& getConvertedFunctions() const;
+
+private:
+    struct Plan {
+        bool accumulates = false;
+        BinaryOp::Operator op = BinaryOp::Operator::ADD;
+        TypePtr accumulatorType;
+        std::string accumulator;
+        // A recursive call used as a statement, in a void function
+        bool statementCalls = false;
+    };
+
+    std::unordered_set<std::string> globalNames;
+    std::vector<std::string> convertedFunctions;
+    int tempCounter = 0;
+
+    bool analyze(const std::shared_ptr<Function>& func, Plan& plan) const;
+    bool analyzeBlock(const std::shared_ptr<Function>& func, const std::vector<StmtPtr>& block, bool inLoop,
+                      bool tailBlock, Plan& plan, int& matchedCalls) const;
+    void rewriteBlock(const std::shared_ptr<Function>& func, std::vector<StmtPtr>& block, bool tailBlock,
+                      Plan& plan);
+    std::vector<StmtPtr> rebindParameters(const std::shared_ptr<Function>& func,
+                                          const std::shared_ptr<FunctionCall>& call);
+
+    static std::shared_ptr<FunctionCall> tailStatementCall(const std::shared_ptr<Function>& func,
+                                                           const std::vector<StmtPtr>& block, size_t index,
+                                                           bool tailBlock);
+    static bool isTailBranch(const std::vector<StmtPtr>& block, size_t index, bool tailBlock);
+    static bool returnsInts(const std::vector<StmtPtr>& block);
+    static std::shared_ptr<FunctionCall> asSelfCall(const ExprPtr& expr, const std::string& name);
+    static int countSelfCalls(const ExprPtr& expr, const std::string& name);
+    static int countSelfCalls(const std::vector<StmtPtr>& block, const std::string& name);
+};
@@ -71,7 +71,7 @@ StmtPtr Parser::declaration() {
 bool Parser::isType() {
     return check(TokenType::INT) || check(TokenType::FLOAT) ||
            check(TokenType::STRING) || check(TokenType::BOOL) ||
-           check(TokenType::LIST);
+           check(TokenType::LIST) || check(TokenType::MATRIX);
 }
 
 StmtPtr Parser::varDeclaration() {
@@ -114,6 +114,12 @@ StmtPtr Parser::statement() {
     if (match(TokenType::IF)) return ifStatement();
     if (match(TokenType::WHILE)) return whileStatement();
     if (match(TokenType::FOR)) return forStatement();
+    // `parallel` is only a keyword in front of `for`
+    if (check(TokenType::IDENTIFIER) && peek().lexeme == "parallel" && checkNext(TokenType::FOR)) {
+        advance();
+        advance();
+        return forStatement(true);
+    }
     if (match(TokenType::TRY)) return tryCatchStatement();
     if (match(TokenType::RETURN)) return returnStatement();
     if (match(TokenType::ENDLOOP)) return EndLoopStatement();
@@ -188,7 +194,7 @@ StmtPtr Parser::whileStatement() {
     return std::make_shared<While>(condition, body);
 }
 
-StmtPtr Parser::forStatement() {
+StmtPtr Parser::forStatement(bool parallel) {
     consume(TokenType::LPAREN, "Expect '(' after 'for'.");
     Token iterator = consume(TokenType::IDENTIFIER, "Expect iterator variable.");
     consume(TokenType::COMMA, "Expect ',' after iterator.");
@@ -203,10 +209,35 @@ StmtPtr Parser::forStatement() {
     }
 
     consume(TokenType::RPAREN, "Expect ')' after for condition.");
+
+    // A parallel loop may name its reductions, e.g. `reduce(+: total, *: product)`
+    std::vector<std::pair<BinaryOp::Operator, std::string>> reductions;
+    if (parallel && check(TokenType::IDENTIFIER) && peek().lexeme == "reduce" && checkNext(TokenType::LPAREN)) {
+        advance();
+        advance();
+        do {
+            BinaryOp::Operator op;
+            if (match(TokenType::PLUS)) {
+                op = BinaryOp::Operator::ADD;
+            } else if (match(TokenType::MULTIPLY)) {
+                op = BinaryOp::Operator::MUL;
+            } else {
+                throw ParseError("Expect '+' or '*' in reduction.", peek());
+            }
+            consume(TokenType::COLON, "Expect ':' after reduction operator.");
+            Token name = consume(TokenType::IDENTIFIER, "Expect reduction variable name.");
+            reductions.emplace_back(op, name.lexeme);
+        } while (match(TokenType::COMMA));
+        consume(TokenType::RPAREN, "Expect ')' after reductions.");
+    }
+
     consume(TokenType::LBRACE, "Expect '{' before for block.");
 
     std::vector<StmtPtr> body = block();
-    return std::make_shared<For>(iterator.lexeme, start, end, step, body);
+    auto loop = std::make_shared<For>(iterator.lexeme, start, end, step, body);
+    loop->parallel = parallel;
+    loop->reductions = std::move(reductions);
+    return loop;
 }
 
 StmtPtr Parser::printStatement() {
@@ -558,6 +589,12 @@ TypePtr Parser::parseType() {
         consume(TokenType::GREATER_THAN, "Expect '>' after list element type.");
         return std::make_shared<Type>(Type::Kind::LIST, elementType);
     }
+    if (match(TokenType::MATRIX)) {
+        consume(TokenType::LESS_THAN, "Expect '<' after 'matrix'.");
+        TypePtr elementType = parseType();
+        consume(TokenType::GREATER_THAN, "Expect '>' after matrix element type.");
+        return std::make_shared<Type>(Type::Kind::MATRIX, elementType);
+    }
 
     throw ParseError("Expect type.", peek());
 }
@@ -53,7 +53,8 @@ private:
     std::vector<StmtPtr> block();
     StmtPtr ifStatement();
     StmtPtr whileStatement();
-    StmtPtr forStatement();
+    // `parallel for` when parallel is set
+    StmtPtr forStatement(bool parallel = false);
     StmtPtr returnStatement();
     StmtPtr printStatement();
     StmtPtr inputStatement();
@@ -0,0 +1,181 @@
+#pragma once
+
+// Replaces the global operator new and delete of a generated program built
+// with --alloc=arena or --alloc-stats. Included by the generated file only,
+// after defining HL_ALLOC_ARENA and/or HL_ALLOC_STATS, since the
+// replacements must be defined exactly once in the program.
+//
+// The arena serves requests of up to 1008 bytes from size classes 16 bytes
+// apart. Each thread carves blocks out of large chunks and keeps the
+// blocks freed on it in one free list per class, so allocating and freeing
+// are a few instructions with no locking; a block freed on another thread
+// is reused there. Chunks are never returned to the system. Larger requests
+// go to malloc. With stats on, the number and total size of allocations are
+// written to standard error at exit, along with what the arena took from
+// the system.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace hl::alloc {
+
+#ifdef HL_ALLOC_STATS
+inline std::atomic<unsigned long long> allocations{0};
+inline std::atomic<unsigned long long> allocatedBytes{0};
+inline std::atomic<unsigned long long> systemBytes{0};
+
+inline void report() {
+    std::fprintf(stderr, "hl: %llu allocations, %llu bytes",
+                 allocations.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed));
+#ifdef HL_ALLOC_ARENA
+    std::fprintf(stderr, " (arena chunks and large blocks: %llu bytes from the system)",
+                 systemBytes.load(std::memory_order_relaxed));
+#endif
+    std::fprintf(stderr, "\n");
+}
+
+inline const bool reportRegistered = std::atexit(report) == 0;
+
+inline void count(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+#endif
+
+inline void* systemAllocate(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+#if defined(HL_ALLOC_STATS) && defined(HL_ALLOC_ARENA)
+    systemBytes.fetch_add(size, std::memory_order_relaxed);
+#endif
+    return p;
+}
+
+#ifdef HL_ALLOC_ARENA
+// Every block starts with a 16-byte header holding its size class, 0 for
+// blocks from malloc, which keeps the blocks after it 16-byte aligned
+constexpr std::size_t kGranule = 16;
+constexpr std::size_t kClasses = 64;
+constexpr std::size_t kChunk = 256 * 1024;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct ThreadCache {
+    FreeBlock* free[kClasses + 1] = {};
+    char* next = nullptr;
+    char* end = nullptr;
+};
+
+inline thread_local ThreadCache cache;
+
+inline void* allocate(std::size_t size) {
+    // One granule more than the request, for the header; a zero-size
+    // request still gets a block of its own
+    std::size_t sizeClass = (size ? size + kGranule - 1 : kGranule) / kGranule + 1;
+    char* block;
+    if (sizeClass > kClasses) {
+        block = static_cast<char*>(systemAllocate(size + kGranule));
+        sizeClass = 0;
+    } else if (FreeBlock* reused = cache.free[sizeClass]) {
+        cache.free[sizeClass] = reused->next;
+        block = reinterpret_cast<char*>(reused);
+    } else {
+        std::size_t bytes = sizeClass * kGranule;
+        if (static_cast<std::size_t>(cache.end - cache.next) < bytes) {
+            cache.next = static_cast<char*>(systemAllocate(kChunk));
+            cache.end = cache.next + kChunk;
+        }
+        block = cache.next;
+        cache.next += bytes;
+    }
+    *reinterpret_cast<std::size_t*>(block) = sizeClass;
+    return block + kGranule;
+}
+
+inline void deallocate(void* p) noexcept {
+    if (!p) {
+        return;
+    }
+    char* block = static_cast<char*>(p) - kGranule;
+    std::size_t sizeClass = *reinterpret_cast<std::size_t*>(block);
+    if (sizeClass == 0) {
+        std::free(block);
+        return;
+    }
+    auto* freed = reinterpret_cast<FreeBlock*>(block);
+    freed->next = cache.free[sizeClass];
+    cache.free[sizeClass] = freed;
+}
+#else
+inline void* allocate(std::size_t size) {
+    return systemAllocate(size);
+}
+
+inline void deallocate(void* p) noexcept {
+    std::free(p);
+}
+#endif
+
+inline void* countedAllocate(std::size_t size) {
+#ifdef HL_ALLOC_STATS
+    count(size);
+#endif
+    return allocate(size);
+}
+
+}  // namespace hl::alloc
+
+void* operator new(std::size_t size) {
+    return hl::alloc::countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return hl::alloc::countedAllocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return hl::alloc::countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return hl::alloc::countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept {
+    hl::alloc::deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+    hl::alloc::deallocate(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    hl::alloc::deallocate(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    hl::alloc::deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    hl::alloc::deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    hl::alloc::deallocate(p);
+}
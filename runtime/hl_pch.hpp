@@ -0,0 +1,19 @@
+// Precompiled once per compiler and flags by the driver and force-included
+// into every generated program, so none of these are parsed per build.
+// Include guards rather than #pragma once, which warns in a precompiled file
+#ifndef HL_PCH_HPP
+#define HL_PCH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "hl_runtime.hpp"
+
+#endif
@@ -0,0 +1,934 @@
+#include "hl_runtime.hpp"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// Compiled for AVX2 whatever the flags, and only called when the CPU has it
+#define HL_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace hl {
+
+std::string to_upper(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::toupper(c); });
+    return text;
+}
+
+std::string to_lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string str_replace_all(std::string text, const std::string& from, const std::string& to) {
+    if (from.empty()) {
+        return text;
+    }
+    size_t pos = 0;
+    while ((pos = text.find(from, pos)) != std::string::npos) {
+        text.replace(pos, from.length(), to);
+        pos += to.length();
+    }
+    return text;
+}
+
+int to_binary(int n) {
+    if (n <= 0) {
+        return n % 2;
+    }
+    // More digits than a long holds; the string conversion this replaces
+    // failed the same way
+    int width = std::bit_width(static_cast<unsigned>(n));
+    if (width > 19) {
+        throw std::out_of_range("toBinary");
+    }
+    long long digits = 0;
+    for (int bit = width - 1; bit >= 0; --bit) {
+        digits = digits * 10 + ((n >> bit) & 1);
+    }
+    return static_cast<int>(digits);
+}
+
+namespace {
+
+// Standard output behind print(). Text is copied into one large buffer and
+// handed to stdio a buffer at a time; a terminal still gets every line as it
+// is printed
+class Output {
+public:
+    Output() : terminal(isatty(STDOUT_FILENO)) {
+        // An uncaught exception ends the program without running destructors
+        previousTerminate = std::set_terminate(onTerminate);
+    }
+
+    ~Output() {
+        flush();
+    }
+
+    void write(std::string_view text) {
+        if (text.size() > buffer.size() - used) {
+            flush();
+            if (text.size() > buffer.size()) {
+                std::fwrite(text.data(), 1, text.size(), stdout);
+                return;
+            }
+        }
+        text.copy(buffer.data() + used, text.size());
+        used += text.size();
+    }
+
+    // Room for at least `size` characters, written with commit()
+    char* reserve(size_t size) {
+        if (size > buffer.size() - used) {
+            flush();
+        }
+        return buffer.data() + used;
+    }
+
+    void commit(char* end) {
+        used = end - buffer.data();
+    }
+
+    void endLine() {
+        *reserve(1) = '\n';
+        ++used;
+        if (terminal) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (used > 0) {
+            std::fwrite(buffer.data(), 1, used, stdout);
+            used = 0;
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    std::array<char, 1 << 16> buffer;
+    size_t used = 0;
+    bool terminal;
+
+    static inline std::terminate_handler previousTerminate = nullptr;
+
+    static void onTerminate();
+};
+
+Output& output() {
+    static Output instance;
+    return instance;
+}
+
+void Output::onTerminate() {
+    output().flush();
+    previousTerminate();
+}
+
+template <typename T, typename... Format>
+void printNumber(T value, Format... format) {
+    // Enough for any double in %g form
+    constexpr size_t longest = 32;
+    char* start = output().reserve(longest);
+    output().commit(std::to_chars(start, start + longest, value, format...).ptr);
+    output().endLine();
+}
+
+}
+
+namespace detail {
+
+void print_text(std::string_view text) {
+    output().write(text);
+    output().endLine();
+}
+
+void print_integer(long long value) {
+    printNumber(value);
+}
+
+void print_unsigned(unsigned long long value) {
+    printNumber(value);
+}
+
+void print_float(double value) {
+    // std::cout's default: six significant digits, %g style
+    printNumber(value, std::chars_format::general, 6);
+}
+
+}
+
+void flush() {
+    output().flush();
+}
+
+namespace {
+
+// Standard input behind input(), readInts() and readLines()
+class Input {
+public:
+    // The next line without its newline; false once input has run out
+    bool readLine(std::string& line) {
+        size_t scanned = 0;
+        while (true) {
+            size_t newline = buffer.find('\n', start + scanned);
+            if (newline != std::string::npos) {
+                line.assign(buffer, start, newline - start);
+                start = newline + 1;
+                return true;
+            }
+            scanned = buffer.size() - start;
+            if (!fill()) {
+                line.assign(buffer, start);
+                start = buffer.size();
+                return !line.empty();
+            }
+        }
+    }
+
+    // Everything not read yet
+    std::string_view rest() {
+        while (fill()) {
+        }
+        std::string_view text = std::string_view(buffer).substr(start);
+        start = buffer.size();
+        return text;
+    }
+
+private:
+    static constexpr size_t block = 1 << 16;
+    std::string buffer;
+    size_t start = 0;
+    bool ended = false;
+
+    // Appends the next block of input; false at the end
+    bool fill() {
+        if (ended) {
+            return false;
+        }
+        // Drop what has been consumed once it is most of the buffer
+        if (start > 0 && start >= buffer.size() / 2) {
+            buffer.erase(0, start);
+            start = 0;
+        }
+        size_t size = buffer.size();
+        buffer.resize(size + block);
+        ssize_t count;
+        do {
+            count = ::read(STDIN_FILENO, buffer.data() + size, block);
+        } while (count < 0 && errno == EINTR);
+        buffer.resize(size + std::max<ssize_t>(count, 0));
+        ended = count <= 0;
+        return !ended;
+    }
+};
+
+Input& standardInput() {
+    static Input instance;
+    return instance;
+}
+
+bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c));
+}
+
+// from_chars takes a minus sign but not a plus
+const char* skipPlus(const char* first, const char* last) {
+    if (last - first >= 2 && *first == '+' && std::isdigit(static_cast<unsigned char>(first[1]))) {
+        return first + 1;
+    }
+    return first;
+}
+
+}
+
+std::string input(const std::string& prompt) {
+    output().write(prompt);
+    output().flush();
+    std::string line;
+    standardInput().readLine(line);
+    return line;
+}
+
+std::vector<int> read_ints() {
+    output().flush();
+    std::string_view text = standardInput().rest();
+    const char* first = text.data();
+    const char* last = first + text.size();
+    std::vector<int> values;
+    while (true) {
+        while (first != last && isSpace(*first)) {
+            ++first;
+        }
+        if (first == last) {
+            return values;
+        }
+        int value;
+        auto [next, error] = std::from_chars(skipPlus(first, last), last, value);
+        if (error == std::errc::result_out_of_range) {
+            throw std::out_of_range("readInts(): " + std::string(first, next) + " does not fit in an int");
+        }
+        if (error != std::errc() || (next != last && !isSpace(*next))) {
+            const char* end = std::find_if(first, last, isSpace);
+            throw std::invalid_argument("readInts(): " + std::string(first, end) + " is not an integer");
+        }
+        values.push_back(value);
+        first = next;
+    }
+}
+
+std::vector<std::string> read_lines() {
+    output().flush();
+    std::string_view text = standardInput().rest();
+    std::vector<std::string> lines;
+    while (!text.empty()) {
+        size_t newline = std::min(text.find('\n'), text.size());
+        lines.emplace_back(text.substr(0, newline));
+        text.remove_prefix(std::min(newline + 1, text.size()));
+    }
+    return lines;
+}
+
+int to_int(std::string_view text) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    while (first != last && isSpace(*first)) {
+        ++first;
+    }
+    // Like std::stoi, whatever follows the digits is ignored
+    int value;
+    auto [next, error] = std::from_chars(skipPlus(first, last), last, value);
+    if (error == std::errc::invalid_argument) {
+        throw std::invalid_argument("stoi");
+    }
+    if (error == std::errc::result_out_of_range) {
+        throw std::out_of_range("stoi");
+    }
+    return value;
+}
+
+namespace {
+
+using Body = std::function<void(long long, long long)>;
+
+// Set while a thread runs chunks, so a nested parallel loop runs inline
+thread_local bool insideChunk = false;
+
+// Worker threads started on first use and kept until exit. Each participant
+// (the calling thread is number 0) owns a deque of chunks: it takes from the
+// front of its own and, once that is empty, steals from the back of others'
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const {
+        return queues.size();
+    }
+
+    void run(long long total, const Body& body) {
+        // Several chunks per thread, so a slow one can be balanced by stealing
+        long long chunks = std::min<long long>(total, static_cast<long long>(queues.size()) * 8);
+        long long grain = (total + chunks - 1) / chunks;
+        chunks = (total + grain - 1) / grain;
+        for (long long k = 0; k < chunks; ++k) {
+            Queue& queue = *queues[k % queues.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.chunks.emplace_back(k * grain, std::min(total, (k + 1) * grain));
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job = &body;
+            remaining = chunks;
+            error = nullptr;
+            ++generation;
+        }
+        wake.notify_all();
+        drain(0, body);
+
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&] { return remaining == 0 && active == 0; });
+        job = nullptr;
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::pair<long long, long long>> chunks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    // Guards everything below
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Body* job = nullptr;
+    long long remaining = 0;
+    int active = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    ThreadPool() {
+        unsigned count = std::thread::hardware_concurrency();
+        if (const char* env = std::getenv("HL_THREADS"); env && std::atoi(env) > 0) {
+            count = static_cast<unsigned>(std::atoi(env));
+        }
+        count = std::max(count, 1u);
+        for (unsigned i = 0; i < count; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 1; i < count; ++i) {
+            workers.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void work(size_t self) {
+        unsigned seen = 0;
+        while (true) {
+            const Body* body;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                // The loop may already be over if this thread woke late
+                if (!job) continue;
+                body = job;
+                ++active;
+            }
+            drain(self, *body);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                --active;
+            }
+            done.notify_all();
+        }
+    }
+
+    void drain(size_t self, const Body& body) {
+        insideChunk = true;
+        std::pair<long long, long long> chunk;
+        while (take(self, chunk)) {
+            try {
+                body(chunk.first, chunk.second);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!error) error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            if (--remaining == 0) done.notify_all();
+        }
+        insideChunk = false;
+    }
+
+    bool take(size_t self, std::pair<long long, long long>& chunk) {
+        for (size_t i = 0; i < queues.size(); ++i) {
+            Queue& queue = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.chunks.empty()) continue;
+            if (i == 0) {
+                chunk = queue.chunks.front();
+                queue.chunks.pop_front();
+            } else {
+                chunk = queue.chunks.back();
+                queue.chunks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+}
+
+void parallel_for(long long total, const Body& body, long long min_total) {
+    if (total <= 0) {
+        return;
+    }
+    if (insideChunk || total < std::max(min_total, 2LL) || ThreadPool::instance().size() == 1) {
+        body(0, total);
+        return;
+    }
+    ThreadPool::instance().run(total, body);
+}
+
+
+namespace {
+
+// int arithmetic wraps rather than overflowing, so the vector and plain
+// loops agree
+int plus(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) + static_cast<unsigned>(b));
+}
+
+float plus(float a, float b) {
+    return a + b;
+}
+
+int times(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) * static_cast<unsigned>(b));
+}
+
+float times(float a, float b) {
+    return a * b;
+}
+
+// Plain loops over [from, n), used without AVX2 and for the elements after
+// the last full vector
+template <typename T>
+T sum_from(const T* xs, size_t from, size_t n, T total) {
+    for (size_t i = from; i < n; ++i) {
+        total = plus(total, xs[i]);
+    }
+    return total;
+}
+
+template <typename T>
+T dot_from(const T* xs, const T* ys, size_t from, size_t n, T total) {
+    for (size_t i = from; i < n; ++i) {
+        total = plus(total, times(xs[i], ys[i]));
+    }
+    return total;
+}
+
+template <typename T>
+T min_from(const T* xs, size_t from, size_t n, T result) {
+    for (size_t i = from; i < n; ++i) {
+        result = std::min(result, xs[i]);
+    }
+    return result;
+}
+
+template <typename T>
+T max_from(const T* xs, size_t from, size_t n, T result) {
+    for (size_t i = from; i < n; ++i) {
+        result = std::max(result, xs[i]);
+    }
+    return result;
+}
+
+template <typename T>
+void scale_from(const T* xs, T k, T* out, size_t from, size_t n) {
+    for (size_t i = from; i < n; ++i) {
+        out[i] = times(xs[i], k);
+    }
+}
+
+template <typename T>
+void add_from(const T* xs, const T* ys, T* out, size_t from, size_t n) {
+    for (size_t i = from; i < n; ++i) {
+        out[i] = plus(xs[i], ys[i]);
+    }
+}
+
+// out[i] += k * xs[i], the inner step of matmul
+template <typename T>
+void axpy_from(T k, const T* xs, T* out, size_t from, size_t n) {
+    for (size_t i = from; i < n; ++i) {
+        out[i] = plus(out[i], times(k, xs[i]));
+    }
+}
+
+#ifdef HL_AVX2
+bool has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+HL_AVX2 __m256i load(const int* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+HL_AVX2 void store(int* p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+// The eight lanes of v, to be folded with the plain loops
+template <typename T, typename Vector>
+HL_AVX2 std::array<T, 8> lanes(Vector v) {
+    std::array<T, 8> result;
+    if constexpr (std::is_same_v<T, int>) {
+        store(result.data(), v);
+    } else {
+        _mm256_storeu_ps(result.data(), v);
+    }
+    return result;
+}
+
+HL_AVX2 int sum_avx2(const int* xs, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_epi32(acc, load(xs + i));
+    }
+    auto part = lanes<int>(acc);
+    return sum_from(xs, i, n, sum_from(part.data(), 0, 8, 0));
+}
+
+HL_AVX2 float sum_avx2(const float* xs, size_t n) {
+    // Two accumulators hide the latency of the adds
+    __m256 first = _mm256_setzero_ps();
+    __m256 second = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        first = _mm256_add_ps(first, _mm256_loadu_ps(xs + i));
+        second = _mm256_add_ps(second, _mm256_loadu_ps(xs + i + 8));
+    }
+    for (; i + 8 <= n; i += 8) {
+        first = _mm256_add_ps(first, _mm256_loadu_ps(xs + i));
+    }
+    auto part = lanes<float>(_mm256_add_ps(first, second));
+    return sum_from(xs, i, n, sum_from(part.data(), 0, 8, 0.0f));
+}
+
+HL_AVX2 int min_avx2(const int* xs, size_t n) {
+    if (n < 8) {
+        return min_from(xs, 1, n, xs[0]);
+    }
+    __m256i acc = load(xs);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_min_epi32(acc, load(xs + i));
+    }
+    auto part = lanes<int>(acc);
+    return min_from(xs, i, n, min_from(part.data(), 1, 8, part[0]));
+}
+
+HL_AVX2 float min_avx2(const float* xs, size_t n) {
+    if (n < 8) {
+        return min_from(xs, 1, n, xs[0]);
+    }
+    __m256 acc = _mm256_loadu_ps(xs);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_min_ps(acc, _mm256_loadu_ps(xs + i));
+    }
+    auto part = lanes<float>(acc);
+    return min_from(xs, i, n, min_from(part.data(), 1, 8, part[0]));
+}
+
+HL_AVX2 int max_avx2(const int* xs, size_t n) {
+    if (n < 8) {
+        return max_from(xs, 1, n, xs[0]);
+    }
+    __m256i acc = load(xs);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_epi32(acc, load(xs + i));
+    }
+    auto part = lanes<int>(acc);
+    return max_from(xs, i, n, max_from(part.data(), 1, 8, part[0]));
+}
+
+HL_AVX2 float max_avx2(const float* xs, size_t n) {
+    if (n < 8) {
+        return max_from(xs, 1, n, xs[0]);
+    }
+    __m256 acc = _mm256_loadu_ps(xs);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_ps(acc, _mm256_loadu_ps(xs + i));
+    }
+    auto part = lanes<float>(acc);
+    return max_from(xs, i, n, max_from(part.data(), 1, 8, part[0]));
+}
+
+HL_AVX2 int dot_avx2(const int* xs, const int* ys, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(load(xs + i), load(ys + i)));
+    }
+    auto part = lanes<int>(acc);
+    return dot_from(xs, ys, i, n, sum_from(part.data(), 0, 8, 0));
+}
+
+HL_AVX2 float dot_avx2(const float* xs, const float* ys, size_t n) {
+    __m256 first = _mm256_setzero_ps();
+    __m256 second = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        first = _mm256_add_ps(first, _mm256_mul_ps(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i)));
+        second = _mm256_add_ps(second, _mm256_mul_ps(_mm256_loadu_ps(xs + i + 8), _mm256_loadu_ps(ys + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8) {
+        first = _mm256_add_ps(first, _mm256_mul_ps(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i)));
+    }
+    auto part = lanes<float>(_mm256_add_ps(first, second));
+    return dot_from(xs, ys, i, n, sum_from(part.data(), 0, 8, 0.0f));
+}
+
+HL_AVX2 void scale_avx2(const int* xs, int k, int* out, size_t n) {
+    __m256i factor = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        store(out + i, _mm256_mullo_epi32(load(xs + i), factor));
+    }
+    scale_from(xs, k, out, i, n);
+}
+
+HL_AVX2 void scale_avx2(const float* xs, float k, float* out, size_t n) {
+    __m256 factor = _mm256_set1_ps(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(xs + i), factor));
+    }
+    scale_from(xs, k, out, i, n);
+}
+
+HL_AVX2 void add_avx2(const int* xs, const int* ys, int* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        store(out + i, _mm256_add_epi32(load(xs + i), load(ys + i)));
+    }
+    add_from(xs, ys, out, i, n);
+}
+
+HL_AVX2 void add_avx2(const float* xs, const float* ys, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i)));
+    }
+    add_from(xs, ys, out, i, n);
+}
+
+HL_AVX2 void axpy_avx2(int k, const int* xs, int* out, size_t n) {
+    __m256i factor = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        store(out + i, _mm256_add_epi32(load(out + i), _mm256_mullo_epi32(factor, load(xs + i))));
+    }
+    axpy_from(k, xs, out, i, n);
+}
+
+// Multiply and add stay separate, as in the plain loop, so both round alike
+HL_AVX2 void axpy_avx2(float k, const float* xs, float* out, size_t n) {
+    __m256 factor = _mm256_set1_ps(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i),
+                                                _mm256_mul_ps(factor, _mm256_loadu_ps(xs + i))));
+    }
+    axpy_from(k, xs, out, i, n);
+}
+#endif
+
+template <typename T>
+T sum(const std::vector<T>& xs) {
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        return sum_avx2(xs.data(), xs.size());
+    }
+#endif
+    return sum_from(xs.data(), 0, xs.size(), T(0));
+}
+
+template <typename T>
+T min(const std::vector<T>& xs) {
+    if (xs.empty()) {
+        throw std::runtime_error("min() of an empty list");
+    }
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        return min_avx2(xs.data(), xs.size());
+    }
+#endif
+    return min_from(xs.data(), 1, xs.size(), xs[0]);
+}
+
+template <typename T>
+T max(const std::vector<T>& xs) {
+    if (xs.empty()) {
+        throw std::runtime_error("max() of an empty list");
+    }
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        return max_avx2(xs.data(), xs.size());
+    }
+#endif
+    return max_from(xs.data(), 1, xs.size(), xs[0]);
+}
+
+template <typename T>
+T dot(const std::vector<T>& xs, const std::vector<T>& ys) {
+    if (xs.size() != ys.size()) {
+        throw std::runtime_error("dot() of lists with different lengths");
+    }
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        return dot_avx2(xs.data(), ys.data(), xs.size());
+    }
+#endif
+    return dot_from(xs.data(), ys.data(), 0, xs.size(), T(0));
+}
+
+template <typename T>
+std::vector<T> scale(const std::vector<T>& xs, T k) {
+    std::vector<T> out(xs.size());
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        scale_avx2(xs.data(), k, out.data(), xs.size());
+        return out;
+    }
+#endif
+    scale_from(xs.data(), k, out.data(), 0, xs.size());
+    return out;
+}
+
+template <typename T>
+std::vector<T> add(const std::vector<T>& xs, const std::vector<T>& ys) {
+    if (xs.size() != ys.size()) {
+        throw std::runtime_error("add() of lists with different lengths");
+    }
+    std::vector<T> out(xs.size());
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        add_avx2(xs.data(), ys.data(), out.data(), xs.size());
+        return out;
+    }
+#endif
+    add_from(xs.data(), ys.data(), out.data(), 0, xs.size());
+    return out;
+}
+
+template <typename T>
+void axpy(T k, const T* xs, T* out, size_t n) {
+#ifdef HL_AVX2
+    if (has_avx2()) {
+        axpy_avx2(k, xs, out, n);
+        return;
+    }
+#endif
+    axpy_from(k, xs, out, 0, n);
+}
+
+// A block of b of this many rows and columns (64 KB of floats) stays in
+// cache while each row of a in the chunk is multiplied with it
+constexpr int innerBlock = 64;
+constexpr int columnBlock = 256;
+// Fewer multiply-adds than this run on the calling thread
+constexpr long long parallelWork = 1LL << 20;
+
+template <typename T>
+matrix<T> multiply(const matrix<T>& a, const matrix<T>& b) {
+    if (a.cols() != b.rows()) {
+        throw std::runtime_error("matmul() of a " + std::to_string(a.rows()) + "x" + std::to_string(a.cols()) +
+                                 " and a " + std::to_string(b.rows()) + "x" + std::to_string(b.cols()) + " matrix");
+    }
+    matrix<T> c(a.rows(), b.cols());
+    int inner = a.cols();
+    int columns = b.cols();
+    auto rows = [&](long long first, long long last) {
+        for (int jj = 0; jj < columns; jj += columnBlock) {
+            size_t width = static_cast<size_t>(std::min(columnBlock, columns - jj));
+            for (int kk = 0; kk < inner; kk += innerBlock) {
+                int kEnd = std::min(kk + innerBlock, inner);
+                for (int i = static_cast<int>(first); i < last; ++i) {
+                    for (int k = kk; k < kEnd; ++k) {
+                        axpy(a[i][k], b[k] + jj, c[i] + jj, width);
+                    }
+                }
+            }
+        }
+    };
+    if (static_cast<long long>(a.rows()) * inner * columns < parallelWork) {
+        rows(0, a.rows());
+    } else {
+        parallel_for(a.rows(), rows);
+    }
+    return c;
+}
+
+}
+
+int list_sum(const std::vector<int>& xs) {
+    return sum(xs);
+}
+
+float list_sum(const std::vector<float>& xs) {
+    return sum(xs);
+}
+
+int list_min(const std::vector<int>& xs) {
+    return min(xs);
+}
+
+float list_min(const std::vector<float>& xs) {
+    return min(xs);
+}
+
+int list_max(const std::vector<int>& xs) {
+    return max(xs);
+}
+
+float list_max(const std::vector<float>& xs) {
+    return max(xs);
+}
+
+int list_dot(const std::vector<int>& xs, const std::vector<int>& ys) {
+    return dot(xs, ys);
+}
+
+float list_dot(const std::vector<float>& xs, const std::vector<float>& ys) {
+    return dot(xs, ys);
+}
+
+std::vector<int> list_scale(const std::vector<int>& xs, int k) {
+    return scale(xs, k);
+}
+
+std::vector<float> list_scale(const std::vector<float>& xs, float k) {
+    return scale(xs, k);
+}
+
+std::vector<int> list_add(const std::vector<int>& xs, const std::vector<int>& ys) {
+    return add(xs, ys);
+}
+
+std::vector<float> list_add(const std::vector<float>& xs, const std::vector<float>& ys) {
+    return add(xs, ys);
+}
+
+matrix<int> matmul(const matrix<int>& a, const matrix<int>& b) {
+    return multiply(a, b);
+}
+
+matrix<float> matmul(const matrix<float>& a, const matrix<float>& b) {
+    return multiply(a, b);
+}
+
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+// Runtime support for C++ generated by HorizonLang. Templates are defined
+// here; everything else lives in hl_runtime.cpp, which the driver builds once
+// into a library and links into every program.
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Bumped whenever a helper changes signature; generated code checks it
+#define HL_RUNTIME_VERSION 9
+
+namespace hl {
+
+// Division that throws instead of trapping on a zero divisor. The result has
+// the common type of the operands, so float division stays float
+template <typename L, typename R>
+inline std::common_type_t<L, R> safe_divide(L numerator, R denominator) {
+    if (denominator == 0) {
+        throw std::runtime_error("Division by zero");
+    }
+    return static_cast<std::common_type_t<L, R>>(numerator) / denominator;
+}
+
+std::string to_upper(std::string text);
+std::string to_lower(std::string text);
+// `text.sub(from, to)`: replaces every occurrence, left to right
+std::string str_replace_all(std::string text, const std::string& from, const std::string& to);
+
+template <typename T>
+constexpr bool is_even(T n) {
+    return n % 2 == 0;
+}
+
+// `n.toBinary()`: the binary digits of n read back as a decimal number
+int to_binary(int n);
+
+namespace detail {
+// Every factorial that fits in an int
+constexpr std::array<int, 13> factorials = [] {
+    std::array<int, 13> table{};
+    table[0] = 1;
+    for (size_t i = 1; i < table.size(); ++i) {
+        table[i] = table[i - 1] * static_cast<int>(i);
+    }
+    return table;
+}();
+}
+
+template <typename T>
+constexpr int fact(T n) {
+    if (n >= 0 && n < static_cast<T>(detail::factorials.size()) && n == static_cast<T>(static_cast<int>(n))) {
+        return detail::factorials[static_cast<size_t>(n)];
+    }
+    return static_cast<int>(std::tgamma(n + 1));
+}
+
+// Prints the prompt and reads one line from standard input, after writing
+// out everything printed before it. Standard input is read with read(2) a
+// large block at a time rather than through std::cin
+std::string input(const std::string& prompt);
+// `readInts()`: every whitespace-separated integer left on standard input.
+// Throws on a token that is not an int
+std::vector<int> read_ints();
+// `readLines()`: every line left on standard input, without its newline
+std::vector<std::string> read_lines();
+// `INT(text)`: std::stoi, with the same errors, parsed with from_chars
+int to_int(std::string_view text);
+
+namespace detail {
+// Each writes the value and a newline to the output buffer
+void print_text(std::string_view text);
+void print_integer(long long value);
+void print_unsigned(unsigned long long value);
+void print_float(double value);
+}
+
+// `print x`: output is collected in a large buffer rather than going through
+// std::cout, and written out when the buffer is full, before input() reads,
+// on flush() and at exit, or after every line when standard output is a
+// terminal. Values are formatted the way std::cout formats them
+template <typename T>
+void print(const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        detail::print_text(value ? "1" : "0");
+    } else if constexpr (std::is_same_v<T, char>) {
+        detail::print_text(std::string_view(&value, 1));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        detail::print_integer(value);
+    } else if constexpr (std::is_integral_v<T>) {
+        detail::print_unsigned(value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        detail::print_float(value);
+    } else {
+        detail::print_text(value);
+    }
+}
+
+// `flush()`: writes out everything printed so far
+void flush();
+
+// `STR(x)`: the same text as std::to_string, without going through printf.
+// Strings are returned unchanged
+template <typename T>
+std::string str(const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        return value ? "1" : "0";
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        // Room for every digit of the largest value, six decimals and a sign
+        char buffer[std::numeric_limits<T>::max_exponent10 + 32];
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point_v<T>) {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 6);
+        } else {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        }
+        return std::string(buffer, result.ptr);
+    } else {
+        return std::string(value);
+    }
+}
+
+// `parallel for`: calls body(first, last) on disjoint chunks covering
+// [0, total) from a pool of worker threads, returning once all have run.
+// The first exception a chunk throws is rethrown here. Calls made from
+// inside a chunk run inline, as do loops shorter than min_total.
+// $HL_THREADS overrides the thread count
+void parallel_for(long long total, const std::function<void(long long, long long)>& body, long long min_total = 2);
+
+// List builtins `xs.sum()`, `xs.min()`, `xs.max()`, `xs.dot(ys)`,
+// `xs.scale(k)` and `xs.add(ys)`. They use AVX2 kernels when the CPU has
+// them and plain loops otherwise. min and max throw on an empty list, dot
+// and add on lists of different lengths. int results wrap on overflow
+int list_sum(const std::vector<int>& xs);
+float list_sum(const std::vector<float>& xs);
+int list_min(const std::vector<int>& xs);
+float list_min(const std::vector<float>& xs);
+int list_max(const std::vector<int>& xs);
+float list_max(const std::vector<float>& xs);
+int list_dot(const std::vector<int>& xs, const std::vector<int>& ys);
+float list_dot(const std::vector<float>& xs, const std::vector<float>& ys);
+std::vector<int> list_scale(const std::vector<int>& xs, int k);
+std::vector<float> list_scale(const std::vector<float>& xs, float k);
+std::vector<int> list_add(const std::vector<int>& xs, const std::vector<int>& ys);
+std::vector<float> list_add(const std::vector<float>& xs, const std::vector<float>& ys);
+
+// `matrix<T>`: rows x cols elements in one row-major buffer. m[i] points at
+// row i, so m[i][j] is unchecked like list indexing
+template <typename T>
+class matrix {
+public:
+    matrix() = default;
+
+    // `zeros(rows, cols)`
+    matrix(int rows, int cols) : rows_(rows), cols_(cols) {
+        if (rows < 0 || cols < 0) {
+            throw std::runtime_error("zeros() with a negative size");
+        }
+        data_.resize(static_cast<size_t>(rows) * cols);
+    }
+
+    // A literal such as [[1, 2], [3, 4]]; the compiler checks the rows have
+    // the same length
+    matrix(std::initializer_list<std::initializer_list<T>> values)
+        : rows_(static_cast<int>(values.size())), cols_(values.size() ? static_cast<int>(values.begin()->size()) : 0) {
+        data_.reserve(static_cast<size_t>(rows_) * cols_);
+        for (const auto& row : values) {
+            data_.insert(data_.end(), row.begin(), row.end());
+        }
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    T* operator[](int row) { return data_.data() + static_cast<size_t>(row) * cols_; }
+    const T* operator[](int row) const { return data_.data() + static_cast<size_t>(row) * cols_; }
+
+private:
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<T> data_;
+};
+
+// A list of scalars kept in inline storage while it holds at most N
+// elements, for lists the compiler has found never grow past that, so
+// building one does not allocate. Past N it moves to the heap. Provides the
+// subset of std::vector that list methods and indexing compile to
+template <typename T, size_t N>
+class small_vector {
+    static_assert(std::is_trivially_copyable_v<T>, "small_vector holds scalars");
+
+public:
+    small_vector() = default;
+    small_vector(std::initializer_list<T> values) {
+        reserve(values.size());
+        for (const T& value : values) {
+            data_[size_++] = value;
+        }
+    }
+    small_vector(const small_vector& other) { *this = other; }
+    small_vector& operator=(const small_vector& other) {
+        if (this != &other) {
+            size_ = 0;
+            reserve(other.size_);
+            std::memcpy(data_, other.data_, other.size_ * sizeof(T));
+            size_ = other.size_;
+        }
+        return *this;
+    }
+    ~small_vector() {
+        if (data_ != inline_) {
+            delete[] data_;
+        }
+    }
+
+    size_t size() const { return size_; }
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            grow(capacity);
+        }
+    }
+    void push_back(T value) {
+        if (size_ == capacity_) {
+            grow(2 * capacity_ + 1);
+        }
+        data_[size_++] = value;
+    }
+    T* insert(const T* pos, T value) {
+        size_t i = pos - data_;
+        if (size_ == capacity_) {
+            grow(2 * capacity_ + 1);
+        }
+        std::memmove(data_ + i + 1, data_ + i, (size_ - i) * sizeof(T));
+        data_[i] = value;
+        ++size_;
+        return data_ + i;
+    }
+    T* erase(const T* pos) {
+        size_t i = pos - data_;
+        std::memmove(data_ + i, data_ + i + 1, (size_ - i - 1) * sizeof(T));
+        --size_;
+        return data_ + i;
+    }
+    void clear() { size_ = 0; }
+
+private:
+    void grow(size_t capacity) {
+        T* heap = new T[capacity];
+        std::memcpy(heap, data_, size_ * sizeof(T));
+        if (data_ != inline_) {
+            delete[] data_;
+        }
+        data_ = heap;
+        capacity_ = capacity;
+    }
+
+    T inline_[N > 0 ? N : 1];
+    T* data_ = inline_;
+    size_t size_ = 0;
+    size_t capacity_ = N > 0 ? N : 1;
+};
+
+// `a.matmul(b)`: cache-blocked, with AVX2 kernels when the CPU has them, and
+// large products split across the parallel_for pool. Throws unless
+// a.cols() == b.rows()
+matrix<int> matmul(const matrix<int>& a, const matrix<int>& b);
+matrix<float> matmul(const matrix<float>& a, const matrix<float>& b);
+
+}
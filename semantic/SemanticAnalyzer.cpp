@@ -1,5 +1,8 @@
 #include "SemanticAnalyzer.h"
+#include <functional>
 #include <unordered_set>
+#include "../optimizer/ASTUtils.h"
+#include "../optimizer/EffectAnalysis.h"
 
 bool SemanticAnalyzer::analyze(const std::shared_ptr<Program>& program) {
     enterScope(); // Start the global scope
@@ -21,6 +24,14 @@ bool SemanticAnalyzer::analyze(const std::shared_ptr<Program>& program) {
         checkStatement(stmt);
     }
 
+    // Third pass: parallel loops, which need the types and call effects
+    if (errors.empty()) {
+        EffectAnalysis analysis(program);
+        effects = &analysis;
+        checkParallelLoops(program->statements);
+        effects = nullptr;
+    }
+
     exitScope();
     return errors.empty();
 }
@@ -216,6 +227,9 @@ TypePtr SemanticAnalyzer::checkExpression(const std::shared_ptr<Expression>& exp
         return returnType;
     }
     else if (auto listAccess = std::dynamic_pointer_cast<ListAccess>(expr)) {
+        if (TypePtr elementType = checkMatrixAccess(listAccess)) {
+            return elementType;
+        }
         checkListOperation(listAccess);
         TypePtr listType = checkExpression(listAccess->list);
         TypePtr elementType = (listType->kind == Type::Kind::LIST && listType->elementType) ? listType->elementType : std::make_shared<Type>(Type::Kind::VOID);
@@ -264,6 +278,7 @@ void SemanticAnalyzer::checkVarDeclaration(const std::shared_ptr<VarDecl>& varDe
         return;
     }
 
+    checkDeclaredType(varDecl->type, varDecl->name);
     currentScope()[varDecl->name] = varDecl->type;
     currentInitializedScope()[varDecl->name] = varDecl->initializer != nullptr;
 
@@ -271,7 +286,9 @@ void SemanticAnalyzer::checkVarDeclaration(const std::shared_ptr<VarDecl>& varDe
         constTable[varDecl->name] = varDecl->type;
     }
 
-    if (varDecl->initializer) {
+    if (varDecl->initializer && checkMatrixInitializer(varDecl->initializer, varDecl->type)) {
+        // Typed from the declaration
+    } else if (varDecl->initializer) {
         TypePtr initType = checkExpression(varDecl->initializer);
         if (!areTypesCompatible(varDecl->type, initType)) {
             addError("Type mismatch in variable initialization: " + varDecl->name);
@@ -296,12 +313,19 @@ void SemanticAnalyzer::checkAssignment(const std::shared_ptr<Assignment>& assign
         }
 
         TypePtr targetType = lookupVariable(identifier->name);
-        TypePtr valueType = checkExpression(assignment->value);
-
-        if (!areTypesCompatible(targetType, valueType)) {
-            addError("Type mismatch in assignment to: " + identifier->name);
+        if (!checkMatrixInitializer(assignment->value, targetType)) {
+            TypePtr valueType = checkExpression(assignment->value);
+            if (!areTypesCompatible(targetType, valueType)) {
+                addError("Type mismatch in assignment to: " + identifier->name);
+            }
         }
         currentInitializedScope()[identifier->name] = true;
+    } else if (auto listAccess = std::dynamic_pointer_cast<ListAccess>(assignment->target);
+               listAccess && checkMatrixAccess(listAccess)) {
+        TypePtr valueType = checkExpression(assignment->value);
+        if (!areTypesCompatible(listAccess->type, valueType)) {
+            addError("Type mismatch in matrix assignment.");
+        }
     } else if (auto listAccess = std::dynamic_pointer_cast<ListAccess>(assignment->target)) {
         checkListOperation(listAccess);
         TypePtr listType = checkExpression(listAccess->list);
@@ -338,6 +362,7 @@ void SemanticAnalyzer::checkFunction(const std::shared_ptr<Function>& function)
         if (!paramNames.insert(param.second).second) {
             addError("Duplicate parameter name in function " + function->name + ": " + param.second);
         }
+        checkDeclaredType(param.first, param.second);
         currentScope()[param.second] = param.first;
         currentInitializedScope()[param.second] = true;
     }
@@ -409,6 +434,27 @@ TypePtr SemanticAnalyzer::checkFunctionCall(const std::shared_ptr<FunctionCall>&
             return std::make_shared<Type>(Type::Kind::STRING);
         }
 
+        if (identifier->name == "flush") {
+            if (!funcCall->arguments.empty()) {
+                addError("Function `flush` takes no arguments.");
+            }
+            return std::make_shared<Type>(Type::Kind::VOID);
+        }
+
+        if (identifier->name == "readInts" || identifier->name == "readLines") {
+            if (!funcCall->arguments.empty()) {
+                addError("Function `" + identifier->name + "` takes no arguments.");
+            }
+            auto element = identifier->name == "readInts" ? Type::Kind::INT : Type::Kind::STRING;
+            return std::make_shared<Type>(Type::Kind::LIST, std::make_shared<Type>(element));
+        }
+
+        if (identifier->name == "zeros") {
+            // Typed by checkMatrixInitializer when it initializes a matrix
+            addError("`zeros(rows, cols)` can only initialize or be assigned to a matrix variable.");
+            return std::make_shared<Type>(Type::Kind::VOID);
+        }
+
         // handling for 'STR'
         if (identifier->name == "STR") {
             if (funcCall->arguments.size() != 1) {
@@ -556,11 +602,61 @@ TypePtr SemanticAnalyzer::checkFunctionCall(const std::shared_ptr<FunctionCall>&
                 }
                 return std::make_shared<Type>(Type::Kind::INT);
             }
+            else if (methodName == "sum" || methodName == "min" || methodName == "max" ||
+                     methodName == "dot" || methodName == "scale" || methodName == "add") {
+                // Numeric kernels: the result has the list's element type
+                TypePtr elementType = objectType->elementType;
+                if (!elementType || !isNumericType(elementType)) {
+                    addError("Method `" + methodName + "` requires a list of numbers.");
+                    return std::make_shared<Type>(Type::Kind::VOID);
+                }
+                bool takesList = methodName == "dot" || methodName == "add";
+                size_t expected = takesList || methodName == "scale" ? 1 : 0;
+                if (funcCall->arguments.size() != expected) {
+                    addError(expected ? "Method `" + methodName + "` requires exactly one argument."
+                                      : "Method `" + methodName + "` expects no arguments.");
+                } else if (takesList) {
+                    // No implicit conversion between list<int> and list<float>
+                    TypePtr argType = checkExpression(funcCall->arguments[0]);
+                    if (argType->kind != Type::Kind::LIST || !argType->elementType ||
+                        argType->elementType->kind != elementType->kind) {
+                        addError("Argument to `" + methodName + "` must be a list of the same element type.");
+                    }
+                } else if (expected) {
+                    TypePtr argType = checkExpression(funcCall->arguments[0]);
+                    if (!areTypesCompatible(elementType, argType)) {
+                        addError("Argument to `scale` must match the list's element type.");
+                    }
+                }
+                if (methodName == "scale" || methodName == "add") {
+                    return std::make_shared<Type>(Type::Kind::LIST, elementType);
+                }
+                return std::make_shared<Type>(elementType->kind);
+            }
             else {
                 addError("Invalid method `" + methodName + "` for list type.");
             }
         }
 
+        if (objectType->kind == Type::Kind::MATRIX) {
+            const std::string& methodName = memberAccess->memberName;
+            if (methodName == "rows" || methodName == "cols") {
+                if (!funcCall->arguments.empty()) {
+                    addError("Method `" + methodName + "` expects no arguments.");
+                }
+                return std::make_shared<Type>(Type::Kind::INT);
+            } else if (methodName == "matmul") {
+                if (funcCall->arguments.size() != 1) {
+                    addError("Method `matmul` requires exactly one argument.");
+                } else if (!areTypesCompatible(objectType, checkExpression(funcCall->arguments[0]))) {
+                    addError("Argument to `matmul` must be a matrix of the same element type.");
+                }
+                return objectType;
+            }
+            addError("Invalid method `" + methodName + "` for matrix type.");
+            return std::make_shared<Type>(Type::Kind::VOID);
+        }
+
         if (objectType->kind == Type::Kind::STRING) {
             std::string methodName = memberAccess->memberName;
 
@@ -739,7 +835,9 @@ void SemanticAnalyzer::checkListOperation(const std::shared_ptr<ListAccess>& lis
     TypePtr listType = checkExpression(listOp->list);
     TypePtr indexType = checkExpression(listOp->index);
 
-    if (listType->kind != Type::Kind::LIST) {
+    if (listType->kind == Type::Kind::MATRIX) {
+        addError("A matrix is indexed with two indices, as m[i][j], on a matrix variable");
+    } else if (listType->kind != Type::Kind::LIST) {
         addError("Attempt to index a non-list type");
     }
 
@@ -751,6 +849,86 @@ void SemanticAnalyzer::checkListOperation(const std::shared_ptr<ListAccess>& lis
     listOp->type = (listType->kind == Type::Kind::LIST && listType->elementType) ? listType->elementType : std::make_shared<Type>(Type::Kind::VOID);
 }
 
+void SemanticAnalyzer::checkDeclaredType(const TypePtr& type, const std::string& name) {
+    if (type->kind == Type::Kind::MATRIX && !isNumericType(type->elementType)) {
+        addError("Matrix elements must be int or float: " + name);
+    } else if (type->kind == Type::Kind::LIST && type->elementType) {
+        checkDeclaredType(type->elementType, name);
+    }
+}
+
+TypePtr SemanticAnalyzer::checkMatrixAccess(const std::shared_ptr<ListAccess>& access) {
+    auto row = std::dynamic_pointer_cast<ListAccess>(access->list);
+    auto matrix = row ? std::dynamic_pointer_cast<Identifier>(row->list) : nullptr;
+    if (!matrix || !isVariableDeclared(matrix->name)) {
+        return nullptr;
+    }
+    TypePtr matrixType = lookupVariable(matrix->name);
+    if (matrixType->kind != Type::Kind::MATRIX || !matrixType->elementType) {
+        return nullptr;
+    }
+
+    checkExpression(matrix);
+    TypePtr rowIndex = checkExpression(row->index);
+    TypePtr columnIndex = checkExpression(access->index);
+    if (rowIndex->kind != Type::Kind::INT || columnIndex->kind != Type::Kind::INT) {
+        addError("Matrix indices must be integers");
+    }
+    // The row has the matrix's type, so writes through it count as writes
+    // to a matrix wherever the optimizer tracks aliasing
+    row->type = matrixType;
+    access->type = matrixType->elementType;
+    return access->type;
+}
+
+bool SemanticAnalyzer::checkMatrixInitializer(const ExprPtr& value, const TypePtr& matrixType) {
+    if (!matrixType || matrixType->kind != Type::Kind::MATRIX || !matrixType->elementType) {
+        return false;
+    }
+
+    auto call = std::dynamic_pointer_cast<FunctionCall>(value);
+    auto callee = call ? std::dynamic_pointer_cast<Identifier>(call->callee) : nullptr;
+    if (callee && callee->name == "zeros") {
+        if (call->arguments.size() != 2) {
+            addError("Function `zeros` expects two integer arguments.");
+        } else if (checkExpression(call->arguments[0])->kind != Type::Kind::INT ||
+                   checkExpression(call->arguments[1])->kind != Type::Kind::INT) {
+            addError("Arguments to `zeros` must be integers.");
+        }
+        call->type = matrixType;
+        return true;
+    }
+
+    // [[1, 2], [3, 4]]: one list literal per row, all the same length
+    auto literal = std::dynamic_pointer_cast<Literal>(value);
+    if (!literal || !std::holds_alternative<std::vector<ExprPtr>>(literal->value)) {
+        return false;
+    }
+    const auto& rows = std::get<std::vector<ExprPtr>>(literal->value);
+    size_t columns = 0;
+    for (size_t r = 0; r < rows.size(); ++r) {
+        auto row = std::dynamic_pointer_cast<Literal>(rows[r]);
+        if (!row || !std::holds_alternative<std::vector<ExprPtr>>(row->value)) {
+            addError("Each row of a matrix literal must be a list literal.");
+            return true;
+        }
+        const auto& elements = std::get<std::vector<ExprPtr>>(row->value);
+        if (r == 0) {
+            columns = elements.size();
+        } else if (elements.size() != columns) {
+            addError("Rows of a matrix literal must all have the same length.");
+        }
+        for (const auto& element : elements) {
+            if (!areTypesCompatible(matrixType->elementType, checkExpression(element))) {
+                addError("Type mismatch in matrix literal.");
+            }
+        }
+        row->type = std::make_shared<Type>(Type::Kind::LIST, matrixType->elementType);
+    }
+    literal->type = matrixType;
+    return true;
+}
+
 void SemanticAnalyzer::checkForLoop(const std::shared_ptr<For>& forLoop) {
     enterScope();
 
@@ -788,6 +966,21 @@ void SemanticAnalyzer::checkForLoop(const std::shared_ptr<For>& forLoop) {
         }
     }
 
+    std::unordered_set<std::string> reduced;
+    for (const auto& [op, name] : forLoop->reductions) {
+        if (!reduced.insert(name).second) {
+            addError("Duplicate reduction variable: " + name);
+        } else if (name == forLoop->iterator) {
+            addError("Loop iterator cannot be a reduction variable: " + name);
+        } else if (!isVariableDeclared(name)) {
+            addError("Undefined reduction variable: " + name);
+        } else if (constTable.find(name) != constTable.end()) {
+            addError("Cannot reduce into constant variable: " + name);
+        } else if (!isNumericType(lookupVariable(name))) {
+            addError("Reduction variable must be an int or float: " + name);
+        }
+    }
+
     for (const auto& stmt : forLoop->body) {
         checkStatement(stmt);
     }
@@ -795,6 +988,206 @@ void SemanticAnalyzer::checkForLoop(const std::shared_ptr<For>& forLoop) {
     exitScope();
 }
 
+// Lists whose elements are assigned anywhere in block
+static void collectElementWrites(const std::vector<StmtPtr>& block, std::unordered_set<std::string>& names) {
+    std::function<void(ExprPtr&)> collect = [&](ExprPtr& expr) {
+        if (!expr) return;
+        auto assignment = std::dynamic_pointer_cast<Assignment>(expr);
+        if (assignment && std::dynamic_pointer_cast<ListAccess>(assignment->target)) {
+            names.insert(ASTUtils::rootVariable(assignment->target));
+        }
+        ASTUtils::forEachSubExpression(expr, collect);
+    };
+    for (const auto& stmt : block) {
+        ASTUtils::forEachStatementExpression(stmt, collect);
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { collectElementWrites(nested, names); });
+    }
+}
+
+void SemanticAnalyzer::checkParallelLoops(const std::vector<StmtPtr>& block) {
+    for (const auto& stmt : block) {
+        auto forLoop = std::dynamic_pointer_cast<For>(stmt);
+        if (forLoop && forLoop->parallel) {
+            parallelLoop = forLoop;
+            collectElementWrites(forLoop->body, parallelWrittenLists);
+            checkParallelBlock(forLoop->body, {}, 0);
+            parallelWrittenLists.clear();
+            parallelLoop = nullptr;
+        }
+        ASTUtils::forEachBlock(stmt, [&](std::vector<StmtPtr>& nested) { checkParallelLoops(nested); });
+    }
+}
+
+void SemanticAnalyzer::checkParallelBlock(const std::vector<StmtPtr>& block, std::unordered_set<std::string> locals,
+                                          int depth) {
+    auto check = [&](const ExprPtr& expr) { checkParallelExpression(expr, locals); };
+    for (const auto& stmt : block) {
+        if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(stmt)) {
+            check(varDecl->initializer);
+            locals.insert(varDecl->name);
+        } else if (auto forLoop = std::dynamic_pointer_cast<For>(stmt)) {
+            check(forLoop->start);
+            check(forLoop->end);
+            check(forLoop->step);
+            auto inner = locals;
+            inner.insert(forLoop->iterator);
+            checkParallelBlock(forLoop->body, inner, depth + 1);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<While>(stmt)) {
+            check(whileStmt->condition);
+            checkParallelBlock(whileStmt->body, locals, depth + 1);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<If>(stmt)) {
+            check(ifStmt->condition);
+            checkParallelBlock(ifStmt->thenBlock, locals, depth);
+            for (const auto& elif : ifStmt->elifBlocks) {
+                check(elif.first);
+                checkParallelBlock(elif.second, locals, depth);
+            }
+            checkParallelBlock(ifStmt->elseBlock, locals, depth);
+        } else if (auto tryCatch = std::dynamic_pointer_cast<TryCatch>(stmt)) {
+            checkParallelBlock(tryCatch->tryBlock, locals, depth);
+            auto inner = locals;
+            inner.insert(tryCatch->exceptionName);
+            checkParallelBlock(tryCatch->catchBlock, inner, depth);
+        } else if (std::dynamic_pointer_cast<Print>(stmt) || std::dynamic_pointer_cast<Input>(stmt)) {
+            addError("Parallel loop cannot print or read input; iterations run in no particular order");
+        } else if (std::dynamic_pointer_cast<Return>(stmt)) {
+            addError("Cannot return from inside a parallel loop");
+        } else if (std::dynamic_pointer_cast<ENDLOOP>(stmt)) {
+            if (depth == 0) {
+                addError("`endloop` cannot leave a parallel loop");
+            }
+        } else {
+            ASTUtils::forEachStatementExpression(stmt, check);
+        }
+    }
+}
+
+void SemanticAnalyzer::checkParallelExpression(const ExprPtr& expr, const std::unordered_set<std::string>& locals) {
+    if (!expr) return;
+    const std::string& iterator = parallelLoop->iterator;
+
+    if (auto assignment = std::dynamic_pointer_cast<Assignment>(expr)) {
+        if (auto target = std::dynamic_pointer_cast<Identifier>(assignment->target)) {
+            BinaryOp::Operator op;
+            if (target->name == iterator && !locals.count(iterator)) {
+                addError("Cannot assign to parallel loop iterator: " + iterator);
+            } else if (isReduction(target->name, locals, &op)) {
+                // Only `x = x op e` (or `x = e op x`) where e does not read x
+                auto value = std::dynamic_pointer_cast<BinaryOp>(assignment->value);
+                auto isTarget = [&](const ExprPtr& side) {
+                    auto ident = std::dynamic_pointer_cast<Identifier>(side);
+                    return ident && ident->name == target->name;
+                };
+                if (value && value->op == op && isTarget(value->left)) {
+                    checkParallelExpression(value->right, locals);
+                    return;
+                }
+                if (value && value->op == op && isTarget(value->right)) {
+                    checkParallelExpression(value->left, locals);
+                    return;
+                }
+                addError("Reduction variable '" + target->name + "' must be updated as " + target->name + " = " +
+                         target->name + (op == BinaryOp::Operator::ADD ? " + " : " * ") + "...");
+                return;
+            } else if (!locals.count(target->name)) {
+                addError("Parallel loop writes shared variable '" + target->name +
+                         "'; declare it inside the loop or as a reduction");
+            }
+        } else {
+            // Each iteration may write only its own element of a shared list
+            std::string root = ASTUtils::rootVariable(assignment->target);
+            if (!root.empty() && !locals.count(root)) {
+                auto access = std::dynamic_pointer_cast<ListAccess>(assignment->target);
+                while (access && !std::dynamic_pointer_cast<Identifier>(access->list)) {
+                    access = std::dynamic_pointer_cast<ListAccess>(access->list);
+                }
+                auto index = access ? std::dynamic_pointer_cast<Identifier>(access->index) : nullptr;
+                if (!index || index->name != iterator || locals.count(iterator)) {
+                    addError("Parallel loop writes shared list '" + root + "' at an index other than '" + iterator +
+                             "'");
+                }
+            }
+            // The element written is checked above; only its indices are read
+            auto access = std::dynamic_pointer_cast<ListAccess>(assignment->target);
+            if (!access) {
+                checkParallelExpression(assignment->target, locals);
+            }
+            for (; access; access = std::dynamic_pointer_cast<ListAccess>(access->list)) {
+                checkParallelExpression(access->index, locals);
+            }
+        }
+        checkParallelExpression(assignment->value, locals);
+        return;
+    }
+
+    if (auto access = std::dynamic_pointer_cast<ListAccess>(expr)) {
+        // Another iteration may be writing any element but this one's own
+        auto list = std::dynamic_pointer_cast<Identifier>(access->list);
+        if (list && parallelWrittenLists.count(list->name) && !locals.count(list->name)) {
+            auto index = std::dynamic_pointer_cast<Identifier>(access->index);
+            if (!index || index->name != iterator || locals.count(iterator)) {
+                addError("Parallel loop reads shared list '" + list->name + "' at an index other than '" + iterator +
+                         "', while other iterations write it");
+            }
+            checkParallelExpression(access->index, locals);
+            return;
+        }
+    }
+
+    if (auto identifier = std::dynamic_pointer_cast<Identifier>(expr)) {
+        if (isReduction(identifier->name, locals)) {
+            addError("Reduction variable '" + identifier->name + "' cannot be read inside the parallel loop");
+        } else if (parallelWrittenLists.count(identifier->name) && !locals.count(identifier->name)) {
+            addError("Parallel loop reads all of shared list '" + identifier->name +
+                     "', while other iterations write its elements");
+        }
+        return;
+    }
+
+    if (auto call = std::dynamic_pointer_cast<FunctionCall>(expr)) {
+        std::string name = ASTUtils::calledFunctionName(call);
+        auto callee = std::dynamic_pointer_cast<Identifier>(call->callee);
+        if (auto member = std::dynamic_pointer_cast<MemberAccess>(call->callee)) {
+            std::string root = ASTUtils::rootVariable(member->object);
+            if (ASTUtils::isMutatingListMethod(member->memberName) && !root.empty() && !locals.count(root)) {
+                addError("Parallel loop resizes shared list '" + root + "'");
+            }
+            // Its length cannot change while the loop runs
+            if (member->memberName == "length" && std::dynamic_pointer_cast<Identifier>(member->object)) {
+                return;
+            }
+        } else if (callee && ASTUtils::isIOBuiltin(callee->name)) {
+            addError("Parallel loop cannot print or read input; iterations run in no particular order");
+        } else if (functionSignatures.count(name)) {
+            const FunctionEffects& calleeEffects = effects->effectsOf(name);
+            if (calleeEffects.performsIO || !calleeEffects.writtenGlobals.empty()) {
+                addError("Parallel loop calls '" + name + "', which writes global state or does I/O");
+            }
+            for (size_t param : calleeEffects.mutatedParams) {
+                if (param >= call->arguments.size()) continue;
+                std::string root = ASTUtils::rootVariable(call->arguments[param]);
+                if (!root.empty() && !locals.count(root)) {
+                    addError("Parallel loop passes shared list '" + root + "' to '" + name + "', which modifies it");
+                }
+            }
+        }
+    }
+
+    ASTUtils::forEachSubExpression(expr, [&](ExprPtr& sub) { checkParallelExpression(sub, locals); });
+}
+
+bool SemanticAnalyzer::isReduction(const std::string& name, const std::unordered_set<std::string>& locals,
+                                   BinaryOp::Operator* op) const {
+    if (locals.count(name)) return false;
+    for (const auto& reduction : parallelLoop->reductions) {
+        if (reduction.second == name) {
+            if (op) *op = reduction.first;
+            return true;
+        }
+    }
+    return false;
+}
+
 void SemanticAnalyzer::checkIfStatement(const std::shared_ptr<If>& ifStmt) {
     TypePtr condType = checkExpression(ifStmt->condition);
     if (condType->kind != Type::Kind::BOOL) {
@@ -846,6 +1239,11 @@ bool SemanticAnalyzer::areTypesCompatible(TypePtr expected, TypePtr actual) cons
     }
 
     if (expected->kind == actual->kind) {
+        if (expected->kind == Type::Kind::MATRIX) {
+            // Stored elements are never converted
+            return expected->elementType && actual->elementType &&
+                   expected->elementType->kind == actual->elementType->kind;
+        }
         if (expected->kind == Type::Kind::LIST) {
             if (expected->elementType && actual->elementType) {
                 return areTypesCompatible(expected->elementType, actual->elementType);
@@ -10,6 +10,8 @@
 #include "../ast/AST.h"
 #include "../ast/ASTprint.h"
 
+class EffectAnalysis;
+
 class SemanticAnalyzer {
 public:
     bool analyze(const std::shared_ptr<Program>& program);
@@ -36,9 +38,31 @@ private:
     void checkFunction(const std::shared_ptr<Function>& function);
     TypePtr checkFunctionCall(const std::shared_ptr<FunctionCall>& funcCall);
     void checkListOperation(const std::shared_ptr<ListAccess>& listOp);
+
+    // Matrices: element types are int or float, elements are read and
+    // written as m[i][j] on a matrix variable, and `zeros(rows, cols)` and
+    // nested list literals take their type from the matrix variable they
+    // initialize or are assigned to
+    void checkDeclaredType(const TypePtr& type, const std::string& name);
+    TypePtr checkMatrixAccess(const std::shared_ptr<ListAccess>& access);
+    bool checkMatrixInitializer(const ExprPtr& value, const TypePtr& matrixType);
     void checkIfStatement(const std::shared_ptr<If>& ifStmt);
     void checkWhileStatement(const std::shared_ptr<While>& whileStmt);
     void checkForLoop(const std::shared_ptr<For>& forLoop);
+
+    // Iterations of a `parallel for` must not race: they may only write
+    // variables declared inside the loop, list elements indexed by the loop
+    // iterator and declared reductions, and may read the elements of a
+    // shared list they write only at that same index. Run once types are
+    // known.
+    std::shared_ptr<For> parallelLoop;
+    std::unordered_set<std::string> parallelWrittenLists;
+    const EffectAnalysis* effects = nullptr;
+    void checkParallelLoops(const std::vector<StmtPtr>& block);
+    void checkParallelBlock(const std::vector<StmtPtr>& block, std::unordered_set<std::string> locals, int depth);
+    void checkParallelExpression(const ExprPtr& expr, const std::unordered_set<std::string>& locals);
+    bool isReduction(const std::string& name, const std::unordered_set<std::string>& locals,
+                     BinaryOp::Operator* op = nullptr) const;
     void checkReturnStatement(const std::shared_ptr<Return>& returnStmt);
     void registerFunction(const std::shared_ptr<Function>& function);
     bool areTypesCompatible(TypePtr expected, TypePtr actual) const;